@@ -0,0 +1,132 @@
+//! Counts heap allocations made while decoding, per packet and per event.
+//!
+//! Run with `cargo bench --bench alloc`.
+
+use barectf_parser::{Config, EventSchema, EventVisitor, Parser, Timestamp};
+use std::{
+    alloc::{GlobalAlloc, Layout, System},
+    sync::atomic::{AtomicU64, Ordering},
+};
+
+mod common;
+use common::{config, synthetic_trace};
+
+const STREAM: &str = "test_resources/fixtures/full/trace/stream";
+
+const EVENTS: u64 = 10_000;
+
+struct CountingAlloc;
+
+static ALLOCS: AtomicU64 = AtomicU64::new(0);
+static BYTES: AtomicU64 = AtomicU64::new(0);
+
+unsafe impl GlobalAlloc for CountingAlloc {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        ALLOCS.fetch_add(1, Ordering::Relaxed);
+        BYTES.fetch_add(layout.size() as u64, Ordering::Relaxed);
+        System.alloc(layout)
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        System.dealloc(ptr, layout)
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        ALLOCS.fetch_add(1, Ordering::Relaxed);
+        BYTES.fetch_add(new_size as u64, Ordering::Relaxed);
+        System.realloc(ptr, layout, new_size)
+    }
+}
+
+#[global_allocator]
+static GLOBAL: CountingAlloc = CountingAlloc;
+
+/// Allocations and bytes allocated while running `f`
+fn count<T>(f: impl FnOnce() -> T) -> (T, u64, u64) {
+    let allocs = ALLOCS.load(Ordering::Relaxed);
+    let bytes = BYTES.load(Ordering::Relaxed);
+    let out = f();
+    (
+        out,
+        ALLOCS.load(Ordering::Relaxed) - allocs,
+        BYTES.load(Ordering::Relaxed) - bytes,
+    )
+}
+
+#[derive(Default)]
+struct EventCounter(u64);
+
+impl EventVisitor for EventCounter {
+    fn on_event_begin(&mut self, _schema: &EventSchema, _timestamp: Timestamp) {
+        self.0 += 1;
+    }
+}
+
+/// Decode every packet of `trace` with `decode`, returning the packet and event counts
+fn decode_all(trace: &[u8], mut decode: impl FnMut(&mut &[u8]) -> u64) -> (u64, u64) {
+    let mut src = trace;
+    let mut packets = 0;
+    let mut events = 0;
+    while !src.is_empty() {
+        events += decode(&mut src);
+        packets += 1;
+    }
+    (packets, events)
+}
+
+fn report(trace: &str, mode: &str, (packets, events): (u64, u64), allocs: u64, bytes: u64) {
+    println!(
+        "{trace:<10} {mode:<12} {packets:>8} {events:>8} {:>12.2} {:>12.2} {:>12.1}",
+        allocs as f64 / packets as f64,
+        allocs as f64 / events as f64,
+        bytes as f64 / events as f64,
+    );
+}
+
+fn measure(cfg: &Config, name: &str, trace: &[u8]) {
+    // Fresh parsers, outside of the counted region
+    let parser = Parser::new(cfg).unwrap();
+    let (counts, allocs, bytes) =
+        count(|| decode_all(trace, |src| parser.parse(src).unwrap().events.len() as u64));
+    report(name, "parse", counts, allocs, bytes);
+
+    let parser = Parser::new(cfg).unwrap().with_string_cache(256);
+    let (counts, allocs, bytes) =
+        count(|| decode_all(trace, |src| parser.parse(src).unwrap().events.len() as u64));
+    report(name, "parse+cache", counts, allocs, bytes);
+
+    let parser = Parser::new(cfg).unwrap();
+    let (counts, allocs, bytes) = count(|| {
+        decode_all(trace, |src| {
+            let mut v = EventCounter::default();
+            parser.visit(src, &mut v).unwrap();
+            v.0
+        })
+    });
+    report(name, "visit", counts, allocs, bytes);
+}
+
+fn main() {
+    let cfg = config();
+
+    println!(
+        "{:<10} {:<12} {:>8} {:>8} {:>12} {:>12} {:>12}",
+        "trace", "mode", "packets", "events", "allocs/pkt", "allocs/evt", "bytes/evt"
+    );
+
+    let fixture = std::fs::read(STREAM).unwrap();
+    measure(&cfg, "full", &fixture);
+
+    measure(&cfg, "mixed", &synthetic_trace(&cfg, EVENTS, |_| true));
+
+    let names: Vec<_> = Parser::new(&cfg)
+        .unwrap()
+        .event_schemas()
+        .into_iter()
+        .map(|(_, s)| s.name())
+        .collect();
+    for name in names {
+        let trace = synthetic_trace(&cfg, EVENTS, |n| n == name.as_str());
+        measure(&cfg, name.as_str(), &trace);
+    }
+}
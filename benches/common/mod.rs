@@ -0,0 +1,34 @@
+//! Trace factory shared by the benchmarks
+
+use barectf_parser::{Config, PacketWriter};
+
+const CFG: &str = "test_resources/fixtures/full/effective_config.yaml";
+
+/// Packet size of the synthetic traces, the `full` schema's 16 bit packet size
+/// field limits packets to 8 KiB (`PacketWriter::new` rejects larger ones)
+const PACKET_SIZE: usize = 4096;
+
+/// The `full` fixture's effective configuration
+pub fn config() -> Config {
+    let cfg_str = std::fs::read_to_string(CFG).unwrap();
+    serde_yaml::from_str(&cfg_str).unwrap()
+}
+
+/// A synthetic trace of `events` events, cycling through the event record types
+/// selected by `filter`
+pub fn synthetic_trace(cfg: &Config, events: u64, filter: impl Fn(&str) -> bool) -> Vec<u8> {
+    let mut w = PacketWriter::new(cfg, PACKET_SIZE, Vec::new()).unwrap();
+    let schemas: Vec<_> = w
+        .parser()
+        .event_schemas()
+        .into_iter()
+        .filter(|(_, s)| filter(s.name().as_str()))
+        .collect();
+    for i in 0..events {
+        let (stream_id, schema) = schemas[i as usize % schemas.len()];
+        let values = w.synthetic_values(stream_id, schema.id(), i).unwrap();
+        w.write_event(stream_id, schema.id(), i * 100, &values)
+            .unwrap();
+    }
+    w.into_inner().unwrap()
+}
@@ -0,0 +1,110 @@
+use barectf_parser::Parser;
+use criterion::{
+    black_box, criterion_group, criterion_main, BatchSize, BenchmarkId, Criterion, Throughput,
+};
+use tokio_stream::StreamExt;
+use tokio_util::codec::FramedRead;
+
+mod common;
+use common::{config, synthetic_trace};
+
+/// Event counts of the synthetic traces
+const SIZES: [u64; 3] = [1_000, 10_000, 100_000];
+
+/// Decode every packet of `trace`, returning the number of events
+fn parse_all(parser: &Parser, trace: &[u8]) -> usize {
+    let mut src = trace;
+    let mut events = 0;
+    while !src.is_empty() {
+        events += parser.parse(&mut src).unwrap().events.len();
+    }
+    events
+}
+
+/// Field type decode cost, through traces made of a single event record type each:
+/// `foobar` (byte-packed integers), `floats`, `enums`, `init` (string) and `arrays`
+/// (static integer array and dynamic string array)
+fn event_types(c: &mut Criterion) {
+    let cfg = config();
+    let parser = Parser::new(&cfg).unwrap();
+    let mut group = c.benchmark_group("event_type");
+    for (_, schema) in parser.event_schemas() {
+        let name = schema.name();
+        let trace = synthetic_trace(&cfg, 10_000, |n| n == name.as_str());
+        group.throughput(Throughput::Bytes(trace.len() as u64));
+        group.bench_with_input(BenchmarkId::from_parameter(name), &trace, |b, trace| {
+            b.iter(|| parse_all(&parser, black_box(trace)))
+        });
+    }
+    group.finish();
+}
+
+/// `Parser::parse` throughput over mixed traces, in bytes and events
+fn parse(c: &mut Criterion) {
+    let cfg = config();
+    let parser = Parser::new(&cfg).unwrap();
+    let mut group = c.benchmark_group("parse");
+    for events in SIZES {
+        let trace = synthetic_trace(&cfg, events, |_| true);
+        group.throughput(Throughput::Bytes(trace.len() as u64));
+        group.bench_with_input(BenchmarkId::new("bytes", events), &trace, |b, trace| {
+            b.iter(|| parse_all(&parser, black_box(trace)))
+        });
+        group.throughput(Throughput::Elements(events));
+        group.bench_with_input(BenchmarkId::new("events", events), &trace, |b, trace| {
+            b.iter(|| parse_all(&parser, black_box(trace)))
+        });
+    }
+    group.finish();
+}
+
+/// `PacketDecoder` through `FramedRead`, as used by async consumers
+fn framed_read(c: &mut Criterion) {
+    let cfg = config();
+    let rt = tokio::runtime::Builder::new_current_thread()
+        .build()
+        .unwrap();
+    let mut group = c.benchmark_group("framed_read");
+    for events in SIZES {
+        let trace = synthetic_trace(&cfg, events, |_| true);
+        group.throughput(Throughput::Bytes(trace.len() as u64));
+        group.bench_with_input(BenchmarkId::from_parameter(events), &trace, |b, trace| {
+            // A fresh decoder per run, built outside of the timed section
+            b.iter_batched(
+                || Parser::new(&cfg).unwrap().into_packet_decoder(),
+                |decoder| {
+                    rt.block_on(async {
+                        let mut reader = FramedRead::new(black_box(trace.as_slice()), decoder);
+                        let mut events = 0;
+                        while let Some(pkt) = reader.next().await {
+                            events += pkt.unwrap().events.len();
+                        }
+                        events
+                    })
+                },
+                BatchSize::SmallInput,
+            )
+        });
+    }
+    group.finish();
+}
+
+/// `Parser::parse_parallel` over the largest trace
+fn parse_parallel(c: &mut Criterion) {
+    let cfg = config();
+    let parser = Parser::new(&cfg).unwrap();
+    let trace = synthetic_trace(&cfg, SIZES[SIZES.len() - 1], |_| true);
+    let mut group = c.benchmark_group("parse_parallel");
+    group.throughput(Throughput::Bytes(trace.len() as u64));
+    for ranges in [1, 2, 4, 8] {
+        group.bench_with_input(
+            BenchmarkId::from_parameter(ranges),
+            &ranges,
+            |b, &ranges| b.iter(|| parser.parse_parallel(black_box(&trace), ranges).unwrap()),
+        );
+    }
+    group.finish();
+}
+
+criterion_group!(benches, event_types, parse, framed_read, parse_parallel);
+criterion_main!(benches);
@@ -0,0 +1,130 @@
+use barectf_parser::{ArchiveReader, ArchiveWriter, Config, PacketFilter, Parser};
+use clap::Parser as ClapParser;
+use std::{
+    fs,
+    io::{BufReader, BufWriter},
+    path::PathBuf,
+};
+
+/// barectf trace archive example
+///
+/// Archives a stream file into independently compressed frames with an index,
+/// prints the index, and optionally extracts the packets matching the given criteria
+/// by decompressing only the frames that can hold them.
+#[derive(Debug, clap::Parser)]
+struct Opts {
+    /// The barectf effective-configuration yaml file
+    pub config: PathBuf,
+
+    /// The binary CTF stream(s) file
+    pub stream: PathBuf,
+
+    /// The archive file to write
+    pub archive: PathBuf,
+
+    /// Decompressed frame size target (bytes)
+    #[clap(long, default_value_t = ArchiveWriter::<fs::File>::DEFAULT_FRAME_SIZE)]
+    pub frame_size: usize,
+
+    /// zstd compression level
+    #[clap(long, default_value_t = 3)]
+    pub level: i32,
+
+    /// Extract the matching packets from the archive to this binary CTF stream file
+    #[clap(long)]
+    pub extract: Option<PathBuf>,
+
+    /// Extract the packets of this stream ID, can be repeated
+    #[clap(long = "stream-id")]
+    pub stream_ids: Vec<u64>,
+
+    /// First packet sequence number to extract
+    #[clap(long)]
+    pub first_seq: Option<u64>,
+
+    /// Last packet sequence number to extract
+    #[clap(long)]
+    pub last_seq: Option<u64>,
+
+    /// Extract packets ending at or after this timestamp (cycles)
+    #[clap(long)]
+    pub from: Option<u64>,
+
+    /// Extract packets beginning at or before this timestamp (cycles)
+    #[clap(long)]
+    pub to: Option<u64>,
+}
+
+fn main() {
+    tracing_subscriber::fmt::init();
+
+    let opts = Opts::parse();
+
+    let cfg_str = fs::read_to_string(&opts.config).unwrap();
+
+    let cfg: Config = serde_yaml::from_str(&cfg_str).unwrap();
+
+    let parser = Parser::new(&cfg).unwrap();
+
+    let input = BufReader::new(fs::File::open(&opts.stream).unwrap());
+    let output = BufWriter::new(fs::File::create(&opts.archive).unwrap());
+    let mut archive = ArchiveWriter::new(output)
+        .with_frame_size(opts.frame_size)
+        .with_level(opts.level);
+    let packets = parser.archive(input, &mut archive).unwrap();
+    archive.finish().unwrap();
+
+    let mut reader = ArchiveReader::open(fs::File::open(&opts.archive).unwrap()).unwrap();
+    let size: u64 = reader.index().iter().map(|f| f.size).sum();
+    let compressed: u64 = reader.index().iter().map(|f| f.compressed_size).sum();
+    println!(
+        "Archived {} packets in {} frames ({} -> {} bytes)",
+        packets,
+        reader.index().len(),
+        size,
+        compressed
+    );
+    println!(
+        "{:<8} {:>8} {:>8} {:>12} {:>12} {:>16} {:>24}",
+        "frame", "stream", "packets", "bytes", "compressed", "sequence", "timestamps"
+    );
+    for (i, f) in reader.index().iter().enumerate() {
+        println!(
+            "{:<8} {:>8} {:>8} {:>12} {:>12} {:>16} {:>24}",
+            i,
+            f.stream_id,
+            f.packets,
+            f.size,
+            f.compressed_size,
+            f.sequence_numbers
+                .as_ref()
+                .map(|r| format!("{}..={}", r.start(), r.end()))
+                .unwrap_or_default(),
+            f.timestamps
+                .as_ref()
+                .map(|r| format!("{}..={}", r.start(), r.end()))
+                .unwrap_or_default(),
+        );
+    }
+
+    if let Some(path) = &opts.extract {
+        let filter = PacketFilter {
+            streams: (!opts.stream_ids.is_empty()).then_some(opts.stream_ids),
+            sequence_numbers: (opts.first_seq.is_some() || opts.last_seq.is_some())
+                .then(|| opts.first_seq.unwrap_or(0)..=opts.last_seq.unwrap_or(u64::MAX)),
+            timestamps: (opts.from.is_some() || opts.to.is_some())
+                .then(|| opts.from.unwrap_or(0)..=opts.to.unwrap_or(u64::MAX)),
+        };
+        let frames = reader
+            .index()
+            .iter()
+            .filter(|f| f.overlaps(&filter))
+            .count();
+        let output = BufWriter::new(fs::File::create(path).unwrap());
+        let summary = reader.extract(&parser, &filter, output).unwrap();
+        println!(
+            "Extracted {} packets ({} bytes) from {} frames",
+            summary.packets_written, summary.bytes_written, frames
+        );
+    }
+}
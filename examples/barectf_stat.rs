@@ -0,0 +1,249 @@
+use barectf_parser::{
+    Config, EventSchema, EventVisitor, PacketHeader, Parser, StreamId, Timestamp,
+};
+use clap::Parser as ClapParser;
+use internment::Intern;
+use std::{
+    collections::BTreeMap,
+    fs,
+    path::PathBuf,
+    time::{Duration, Instant},
+};
+use tracing::error;
+
+/// barectf trace throughput and profile report
+///
+/// Decodes the stream file from memory in separate passes (packet preambles only,
+/// visited events, parsed events) and reports their timings along with per-stream
+/// and per-event-type volumes.
+#[derive(Debug, clap::Parser)]
+struct Opts {
+    /// The barectf effective-configuration yaml file
+    pub config: PathBuf,
+
+    /// The binary CTF stream(s) file
+    pub stream: PathBuf,
+
+    /// Also report the decode time distribution of each event type, from an
+    /// additional profiled pass
+    #[clap(long)]
+    pub profile: bool,
+}
+
+#[derive(Default)]
+struct StreamTotals {
+    packets: u64,
+    events: u64,
+    packet_bits: u64,
+    content_bits: u64,
+    preamble_bits: u64,
+}
+
+#[derive(Default)]
+struct EventTotals {
+    events: u64,
+    bits: u64,
+}
+
+/// Per-event-type totals, from the visit pass
+#[derive(Default)]
+struct EventStats {
+    stream_id: StreamId,
+    current: Option<(StreamId, Intern<String>)>,
+    events: BTreeMap<(StreamId, Intern<String>), EventTotals>,
+}
+
+impl EventVisitor for EventStats {
+    fn on_packet_header(&mut self, header: &PacketHeader) {
+        self.stream_id = header.stream_id;
+    }
+
+    fn on_event_begin(&mut self, schema: &EventSchema, _timestamp: Timestamp) {
+        self.current = Some((self.stream_id, schema.name()));
+    }
+
+    fn on_event_size(&mut self, bits: usize) {
+        // SAFETY: on_event_size always follows on_event_begin
+        let key = self.current.unwrap();
+        let totals = self.events.entry(key).or_default();
+        totals.events += 1;
+        totals.bits += bits as u64;
+    }
+}
+
+fn main() {
+    tracing_subscriber::fmt::init();
+
+    let opts = Opts::parse();
+
+    let cfg_str = fs::read_to_string(&opts.config).unwrap();
+
+    let cfg: Config = serde_yaml::from_str(&cfg_str).unwrap();
+
+    let start = Instant::now();
+    let data = fs::read(&opts.stream).unwrap();
+    let read_time = start.elapsed();
+
+    // Packet preambles only, hopping from packet to packet
+    let parser = Parser::new(&cfg).unwrap();
+    let mut streams: BTreeMap<StreamId, StreamTotals> = BTreeMap::new();
+    let start = Instant::now();
+    let mut offset = 0;
+    while offset < data.len() {
+        let (header, context, preamble_bytes) = match parser.parse_packet_preamble(&data[offset..])
+        {
+            Ok(p) => p,
+            Err(e) => {
+                error!(offset, "{e}");
+                break;
+            }
+        };
+        let s = streams.entry(header.stream_id).or_default();
+        s.packets += 1;
+        s.packet_bits += context.packet_size_bits as u64;
+        s.content_bits += context.content_size_bits as u64;
+        s.preamble_bits += preamble_bytes as u64 * 8;
+        offset += context.packet_size().max(1);
+    }
+    let preamble_time = start.elapsed();
+    let len = offset.min(data.len());
+
+    // Events handed to a visitor, nothing materialized
+    let parser = Parser::new(&cfg).unwrap();
+    let mut events = EventStats::default();
+    let start = Instant::now();
+    let mut src = &data[..len];
+    while !src.is_empty() {
+        if let Err(e) = parser.visit(&mut src, &mut events) {
+            error!("{e}");
+            break;
+        }
+    }
+    let visit_time = start.elapsed();
+
+    // Packets and events built
+    let parser = Parser::new(&cfg).unwrap();
+    let start = Instant::now();
+    let mut src = &data[..len];
+    let mut event_count = 0_u64;
+    while !src.is_empty() {
+        match parser.parse(&mut src) {
+            Ok(pkt) => event_count += pkt.events.len() as u64,
+            Err(e) => {
+                error!("{e}");
+                break;
+            }
+        }
+    }
+    let parse_time = start.elapsed();
+
+    for ((stream_id, _), totals) in events.events.iter() {
+        if let Some(s) = streams.get_mut(stream_id) {
+            s.events += totals.events;
+        }
+    }
+
+    println!("{} bytes, {} events", len, event_count);
+    println!();
+    println!(
+        "{:<10} {:>12} {:>12} {:>14}",
+        "stage", "time (ms)", "MB/s", "events/s"
+    );
+    for (stage, t) in [
+        ("read", read_time),
+        ("preamble", preamble_time),
+        ("visit", visit_time),
+        ("parse", parse_time),
+    ] {
+        println!(
+            "{:<10} {:>12.3} {:>12.1} {:>14}",
+            stage,
+            t.as_secs_f64() * 1e3,
+            rate(len as u64, t) / 1e6,
+            if stage == "read" || stage == "preamble" {
+                "-".to_owned()
+            } else {
+                format!("{:.0}", rate(event_count, t))
+            }
+        );
+    }
+
+    println!();
+    println!(
+        "{:<8} {:>10} {:>12} {:>14} {:>14} {:>8} {:>10}",
+        "stream", "packets", "events", "packet bytes", "content bytes", "fill %", "preamble %"
+    );
+    for (stream_id, s) in streams.iter() {
+        println!(
+            "{:<8} {:>10} {:>12} {:>14} {:>14} {:>8.1} {:>10.1}",
+            stream_id,
+            s.packets,
+            s.events,
+            s.packet_bits / 8,
+            s.content_bits / 8,
+            percent(s.content_bits, s.packet_bits),
+            percent(s.preamble_bits, s.content_bits),
+        );
+    }
+
+    println!();
+    println!(
+        "{:<8} {:<24} {:>12} {:>14} {:>12} {:>8}",
+        "stream", "event", "events", "bytes", "bytes/event", "bytes %"
+    );
+    let event_bits: u64 = events.events.values().map(|t| t.bits).sum();
+    for ((stream_id, name), t) in events.events.iter() {
+        println!(
+            "{:<8} {:<24} {:>12} {:>14} {:>12.1} {:>8.1}",
+            stream_id,
+            name.as_str(),
+            t.events,
+            t.bits / 8,
+            t.bits as f64 / 8.0 / t.events as f64,
+            percent(t.bits, event_bits),
+        );
+    }
+
+    if opts.profile {
+        let parser = Parser::new(&cfg).unwrap().with_profiling();
+        let mut src = &data[..len];
+        while !src.is_empty() {
+            if let Err(e) = parser.parse(&mut src) {
+                error!("{e}");
+                break;
+            }
+        }
+
+        println!();
+        println!(
+            "{:<8} {:<24} {:>12} {:>10} {:>10} {:>10} {:>10}",
+            "stream", "event", "events", "mean ns", "p50 ns", "p99 ns", "time %"
+        );
+        let profile = parser.profile();
+        let total: Duration = profile.iter().map(|p| p.time).sum();
+        for p in profile.iter().filter(|p| p.events != 0) {
+            println!(
+                "{:<8} {:<24} {:>12} {:>10} {:>10} {:>10} {:>10.1}",
+                p.stream_id,
+                p.schema.name().as_str(),
+                p.events,
+                p.mean_time().as_nanos(),
+                format!("<{}", p.quantile_time(0.5).as_nanos()),
+                format!("<{}", p.quantile_time(0.99).as_nanos()),
+                percent(p.time.as_nanos() as u64, total.as_nanos() as u64),
+            );
+        }
+    }
+}
+
+fn rate(n: u64, t: Duration) -> f64 {
+    n as f64 / t.as_secs_f64().max(f64::MIN_POSITIVE)
+}
+
+fn percent(n: u64, total: u64) -> f64 {
+    if total == 0 {
+        0.0
+    } else {
+        n as f64 * 100.0 / total as f64
+    }
+}
@@ -1,6 +1,12 @@
-use barectf_parser::{Config, Error, Parser};
+use barectf_parser::{Config, DecompressReader, Error, Parser};
+use bytes::BytesMut;
 use clap::Parser as ClapParser;
-use std::{fs, io, path::PathBuf};
+use std::{
+    fs,
+    io::{self, Read},
+    path::PathBuf,
+};
+use tokio_util::codec::Decoder;
 use tracing::error;
 
 /// barectf events reader example
@@ -9,8 +15,12 @@ struct Opts {
     /// The barectf effective-configuration yaml file
     pub config: PathBuf,
 
-    /// The binary CTF stream(s) file
+    /// The binary CTF stream(s) file, optionally compressed
     pub stream: PathBuf,
+
+    /// Skip over corrupt packets instead of stopping at the first one
+    #[clap(long)]
+    pub resync: bool,
 }
 
 fn main() {
@@ -22,10 +32,38 @@ fn main() {
 
     let cfg: Config = serde_yaml::from_str(&cfg_str).unwrap();
 
-    let mut stream = fs::File::open(&opts.stream).unwrap();
+    let mut stream = DecompressReader::new(fs::File::open(&opts.stream).unwrap());
 
     let parser = Parser::new(&cfg).unwrap();
 
+    if opts.resync {
+        // The decoder keeps a window of the stream to scan for the next packet
+        let mut decoder = parser.into_packet_decoder().with_resync();
+        let mut buf = BytesMut::new();
+        let mut chunk = vec![0_u8; 64 * 1024];
+        loop {
+            let n = stream.read(&mut chunk).unwrap();
+            buf.extend_from_slice(&chunk[..n]);
+            let eof = n == 0;
+            while let Some(pkt) = if eof {
+                decoder.decode_eof(&mut buf)
+            } else {
+                decoder.decode(&mut buf)
+            }
+            .unwrap()
+            {
+                println!("{pkt:#?}");
+            }
+            if eof {
+                break;
+            }
+        }
+        if decoder.skipped_bytes() != 0 {
+            error!("Skipped {} corrupt bytes", decoder.skipped_bytes());
+        }
+        return;
+    }
+
     loop {
         let pkt = match parser.parse(&mut stream) {
             Ok(p) => p,
@@ -1,7 +1,6 @@
-use barectf_parser::{Config, Error, Parser};
+use barectf_parser::{AsyncDecompressReader, Config, Error, Parser};
 use clap::Parser as ClapParser;
 use std::{fs, path::PathBuf};
-use tokio::fs::File;
 use tokio_stream::StreamExt;
 use tokio_util::codec::FramedRead;
 use tracing::error;
@@ -12,8 +11,16 @@ struct Opts {
     /// The barectf effective-configuration yaml file
     pub config: PathBuf,
 
-    /// The binary CTF stream(s) file
+    /// The binary CTF stream(s) file, optionally compressed
     pub stream: PathBuf,
+
+    /// Skip over corrupt packets instead of stopping at the first one
+    #[clap(long)]
+    pub resync: bool,
+
+    /// Print the decoder metrics in the Prometheus text format when done
+    #[clap(long)]
+    pub metrics: bool,
 }
 
 #[tokio::main]
@@ -26,11 +33,14 @@ async fn main() -> Result<(), Error> {
 
     let cfg: Config = serde_yaml::from_str(&cfg_str).unwrap();
 
-    let stream = File::open(&opts.stream).await.unwrap();
+    let stream = AsyncDecompressReader::new(fs::File::open(&opts.stream).unwrap());
 
     let parser = Parser::new(&cfg).unwrap();
 
-    let decoder = parser.into_packet_decoder();
+    let mut decoder = parser.into_packet_decoder();
+    if opts.resync {
+        decoder = decoder.with_resync();
+    }
 
     let mut reader = FramedRead::new(stream, decoder);
 
@@ -45,5 +55,16 @@ async fn main() -> Result<(), Error> {
         println!("{pkt:#?}");
     }
 
+    if opts.metrics {
+        let stream = opts.stream.display().to_string();
+        print!(
+            "{}",
+            reader
+                .decoder()
+                .counters()
+                .prometheus_text(&[("stream", &stream)])
+        );
+    }
+
     Ok(())
 }
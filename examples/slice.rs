@@ -0,0 +1,72 @@
+use barectf_parser::{Config, PacketFilter, Parser};
+use clap::Parser as ClapParser;
+use std::{
+    fs,
+    io::{BufReader, BufWriter},
+    path::PathBuf,
+};
+
+/// barectf trace slicer example
+///
+/// Copies the packets matching the given criteria to a new stream file,
+/// without decoding their events.
+#[derive(Debug, clap::Parser)]
+struct Opts {
+    /// The barectf effective-configuration yaml file
+    pub config: PathBuf,
+
+    /// The binary CTF stream(s) file
+    pub stream: PathBuf,
+
+    /// The binary CTF stream file to write
+    pub output: PathBuf,
+
+    /// Keep the packets of this stream ID, can be repeated
+    #[clap(long = "stream-id")]
+    pub stream_ids: Vec<u64>,
+
+    /// First packet sequence number to keep
+    #[clap(long)]
+    pub first_seq: Option<u64>,
+
+    /// Last packet sequence number to keep
+    #[clap(long)]
+    pub last_seq: Option<u64>,
+
+    /// Keep packets ending at or after this timestamp (cycles)
+    #[clap(long)]
+    pub from: Option<u64>,
+
+    /// Keep packets beginning at or before this timestamp (cycles)
+    #[clap(long)]
+    pub to: Option<u64>,
+}
+
+fn main() {
+    tracing_subscriber::fmt::init();
+
+    let opts = Opts::parse();
+
+    let cfg_str = fs::read_to_string(&opts.config).unwrap();
+
+    let cfg: Config = serde_yaml::from_str(&cfg_str).unwrap();
+
+    let parser = Parser::new(&cfg).unwrap();
+
+    let filter = PacketFilter {
+        streams: (!opts.stream_ids.is_empty()).then_some(opts.stream_ids),
+        sequence_numbers: (opts.first_seq.is_some() || opts.last_seq.is_some())
+            .then(|| opts.first_seq.unwrap_or(0)..=opts.last_seq.unwrap_or(u64::MAX)),
+        timestamps: (opts.from.is_some() || opts.to.is_some())
+            .then(|| opts.from.unwrap_or(0)..=opts.to.unwrap_or(u64::MAX)),
+    };
+
+    let input = BufReader::new(fs::File::open(&opts.stream).unwrap());
+    let output = BufWriter::new(fs::File::create(&opts.output).unwrap());
+
+    let summary = parser.slice(input, output, &filter).unwrap();
+    println!(
+        "Wrote {} of {} packets ({} bytes)",
+        summary.packets_written, summary.packets_read, summary.bytes_written
+    );
+}
@@ -0,0 +1,53 @@
+use barectf_parser::{Config, PacketWriter};
+use clap::Parser as ClapParser;
+use std::{fs, io::BufWriter, path::PathBuf};
+
+/// barectf synthetic trace writer example
+///
+/// Writes events of every event record type in turn, with placeholder values.
+#[derive(Debug, clap::Parser)]
+struct Opts {
+    /// The barectf effective-configuration yaml file
+    pub config: PathBuf,
+
+    /// The binary CTF stream(s) file to write
+    pub stream: PathBuf,
+
+    /// Number of events to write
+    #[clap(long, default_value_t = 1_000_000)]
+    pub events: u64,
+
+    /// Packet size in bytes
+    #[clap(long, default_value_t = 4096)]
+    pub packet_size: usize,
+
+    /// Timestamp increment between events, in cycles
+    #[clap(long, default_value_t = 100)]
+    pub interval: u64,
+}
+
+fn main() {
+    tracing_subscriber::fmt::init();
+
+    let opts = Opts::parse();
+
+    let cfg_str = fs::read_to_string(&opts.config).unwrap();
+
+    let cfg: Config = serde_yaml::from_str(&cfg_str).unwrap();
+
+    let out = BufWriter::new(fs::File::create(&opts.stream).unwrap());
+
+    let mut writer = PacketWriter::new(&cfg, opts.packet_size, out).unwrap();
+
+    let schemas = writer.parser().event_schemas();
+
+    for i in 0..opts.events {
+        let (stream_id, schema) = schemas[(i % schemas.len() as u64) as usize];
+        let values = writer.synthetic_values(stream_id, schema.id(), i).unwrap();
+        writer
+            .write_event(stream_id, schema.id(), i * opts.interval, &values)
+            .unwrap();
+    }
+
+    writer.into_inner().unwrap();
+}
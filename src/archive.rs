@@ -0,0 +1,560 @@
+//! Seekable, indexed archives of compressed packets.
+//!
+//! An archive holds a stream file's packets in zstd frames compressed independently of
+//! each other. Each frame holds whole, consecutive packets of a single stream, and the
+//! archive ends with an index of the frames' stream ID, sequence number and timestamp
+//! ranges. [`ArchiveReader`] uses the index to only decompress the frames a
+//! [`PacketFilter`] can select packets from.
+//!
+//! Layout, integers are little-endian:
+//! * [`ARCHIVE_MAGIC`]
+//! * The frames
+//! * The index: one zstd frame of [`ArchiveFrame`] entries, of [`INDEX_ENTRY_SIZE`] bytes
+//! * The footer: index offset (u64), index size (u64), frame count (u64), [`ARCHIVE_MAGIC`]
+//!
+//! Requires the `zstd` feature.
+
+use crate::{
+    error::Error,
+    parser::{PacketFilter, Parser, SliceSummary},
+    types::{PacketContext, PacketHeader, SequenceNumber, StreamId, Timestamp},
+};
+use std::{
+    io::{self, Read, Seek, SeekFrom, Write},
+    ops::RangeInclusive,
+};
+
+/// Magic number at the start and end of an archive
+pub const ARCHIVE_MAGIC: [u8; 8] = *b"BCTFARC1";
+
+/// Size of an encoded [`ArchiveFrame`] index entry
+pub const INDEX_ENTRY_SIZE: usize = 73;
+
+const FOOTER_SIZE: usize = 3 * 8 + ARCHIVE_MAGIC.len();
+const HAS_SEQUENCE_NUMBERS: u8 = 1 << 0;
+const HAS_TIMESTAMPS: u8 = 1 << 1;
+
+/// Index entry of an archive frame
+#[derive(Clone, Debug, PartialEq, Eq)]
+pub struct ArchiveFrame {
+    /// Offset of the compressed frame from the start of the archive
+    pub offset: u64,
+    /// Compressed frame size
+    pub compressed_size: u64,
+    /// Decompressed frame size, i.e. the size of its packets
+    pub size: u64,
+    /// Packets in the frame
+    pub packets: u64,
+    pub stream_id: StreamId,
+    /// Packet sequence numbers, when the stream's packet context has them
+    pub sequence_numbers: Option<RangeInclusive<SequenceNumber>>,
+    /// Packet beginning to end timestamp range (cycles), when the stream's packet
+    /// context has them
+    pub timestamps: Option<RangeInclusive<Timestamp>>,
+}
+
+impl ArchiveFrame {
+    /// Whether `filter` can select any of the frame's packets
+    pub fn overlaps(&self, filter: &PacketFilter) -> bool {
+        if let Some(streams) = &filter.streams {
+            if !streams.contains(&self.stream_id) {
+                return false;
+            }
+        }
+        if let (Some(a), Some(b)) = (&filter.sequence_numbers, &self.sequence_numbers) {
+            if !ranges_overlap(a, b) {
+                return false;
+            }
+        }
+        if let (Some(a), Some(b)) = (&filter.timestamps, &self.timestamps) {
+            if !ranges_overlap(a, b) {
+                return false;
+            }
+        }
+        true
+    }
+
+    fn add_packet(&mut self, context: &PacketContext, size: usize) {
+        self.packets += 1;
+        self.size += size as u64;
+        if let Some(seq) = context.sequence_number {
+            self.sequence_numbers = Some(extend(self.sequence_numbers.take(), seq..=seq));
+        }
+        let begin = context.beginning_timestamp.or(context.end_timestamp);
+        let end = context.end_timestamp.or(context.beginning_timestamp);
+        if let (Some(begin), Some(end)) = (begin, end) {
+            self.timestamps = Some(extend(self.timestamps.take(), begin..=end));
+        }
+    }
+
+    fn encode(&self, out: &mut Vec<u8>) {
+        let mut flags = 0;
+        if self.sequence_numbers.is_some() {
+            flags |= HAS_SEQUENCE_NUMBERS;
+        }
+        if self.timestamps.is_some() {
+            flags |= HAS_TIMESTAMPS;
+        }
+        let seq = self.sequence_numbers.clone().unwrap_or(0..=0);
+        let ts = self.timestamps.clone().unwrap_or(0..=0);
+        for v in [
+            self.offset,
+            self.compressed_size,
+            self.size,
+            self.packets,
+            self.stream_id,
+        ] {
+            out.extend_from_slice(&v.to_le_bytes());
+        }
+        out.push(flags);
+        for v in [*seq.start(), *seq.end(), *ts.start(), *ts.end()] {
+            out.extend_from_slice(&v.to_le_bytes());
+        }
+    }
+
+    fn decode(entry: &[u8]) -> Self {
+        let u64_at = |i: usize| {
+            // SAFETY: entries are INDEX_ENTRY_SIZE bytes
+            u64::from_le_bytes(entry[i..i + 8].try_into().unwrap())
+        };
+        let flags = entry[40];
+        Self {
+            offset: u64_at(0),
+            compressed_size: u64_at(8),
+            size: u64_at(16),
+            packets: u64_at(24),
+            stream_id: u64_at(32),
+            sequence_numbers: (flags & HAS_SEQUENCE_NUMBERS != 0).then(|| u64_at(41)..=u64_at(49)),
+            timestamps: (flags & HAS_TIMESTAMPS != 0).then(|| u64_at(57)..=u64_at(65)),
+        }
+    }
+}
+
+fn ranges_overlap(a: &RangeInclusive<u64>, b: &RangeInclusive<u64>) -> bool {
+    a.start() <= b.end() && b.start() <= a.end()
+}
+
+fn extend(r: Option<RangeInclusive<u64>>, with: RangeInclusive<u64>) -> RangeInclusive<u64> {
+    match r {
+        Some(r) => *r.start().min(with.start())..=*r.end().max(with.end()),
+        None => with,
+    }
+}
+
+/// Writes packets to an archive, see the [module docs](self).
+///
+/// A frame is closed when the stream ID changes or when the next packet would take it
+/// over the frame size, so the packets keep their order.
+#[derive(Debug)]
+pub struct ArchiveWriter<W: Write> {
+    w: W,
+    level: i32,
+    frame_size: usize,
+    offset: u64,
+    buf: Vec<u8>,
+    frame: Option<ArchiveFrame>,
+    index: Vec<ArchiveFrame>,
+}
+
+impl<W: Write> ArchiveWriter<W> {
+    /// Default decompressed frame size target
+    pub const DEFAULT_FRAME_SIZE: usize = 1024 * 1024;
+
+    pub fn new(w: W) -> Self {
+        Self {
+            w,
+            level: zstd::DEFAULT_COMPRESSION_LEVEL,
+            frame_size: Self::DEFAULT_FRAME_SIZE,
+            offset: 0,
+            buf: Vec::new(),
+            frame: None,
+            index: Vec::new(),
+        }
+    }
+
+    /// Set the decompressed frame size target. A packet larger than this gets a frame
+    /// of its own. Smaller frames make queries decompress less, at the expense of the
+    /// compression ratio.
+    pub fn with_frame_size(mut self, bytes: usize) -> Self {
+        self.frame_size = bytes;
+        self
+    }
+
+    /// Set the zstd compression level
+    pub fn with_level(mut self, level: i32) -> Self {
+        self.level = level;
+        self
+    }
+
+    /// Append a packet, `packet` being all of its bytes including the header and context
+    pub fn write_packet(
+        &mut self,
+        header: &PacketHeader,
+        context: &PacketContext,
+        packet: &[u8],
+    ) -> Result<(), Error> {
+        if let Some(frame) = &self.frame {
+            if frame.stream_id != header.stream_id
+                || self.buf.len() + packet.len() > self.frame_size
+            {
+                self.write_frame()?;
+            }
+        }
+        // The offset is set once the frame is written
+        let frame = self.frame.get_or_insert(ArchiveFrame {
+            offset: 0,
+            compressed_size: 0,
+            size: 0,
+            packets: 0,
+            stream_id: header.stream_id,
+            sequence_numbers: None,
+            timestamps: None,
+        });
+        frame.add_packet(context, packet.len());
+        self.buf.extend_from_slice(packet);
+        Ok(())
+    }
+
+    /// Frames written so far
+    pub fn index(&self) -> &[ArchiveFrame] {
+        &self.index
+    }
+
+    /// Write the last frame, the index and the footer, returning the inner writer
+    pub fn finish(mut self) -> Result<W, Error> {
+        self.write_frame()?;
+        self.write_magic()?;
+
+        let mut index = Vec::with_capacity(self.index.len() * INDEX_ENTRY_SIZE);
+        for frame in self.index.iter() {
+            frame.encode(&mut index);
+        }
+        let index = zstd::bulk::compress(&index, self.level)?;
+        self.w.write_all(&index)?;
+
+        for v in [self.offset, index.len() as u64, self.index.len() as u64] {
+            self.w.write_all(&v.to_le_bytes())?;
+        }
+        self.w.write_all(&ARCHIVE_MAGIC)?;
+        self.w.flush()?;
+        Ok(self.w)
+    }
+
+    /// The archive starts with the magic number, written ahead of the first frame
+    fn write_magic(&mut self) -> io::Result<()> {
+        if self.offset == 0 {
+            self.w.write_all(&ARCHIVE_MAGIC)?;
+            self.offset = ARCHIVE_MAGIC.len() as u64;
+        }
+        Ok(())
+    }
+
+    fn write_frame(&mut self) -> Result<(), Error> {
+        self.write_magic()?;
+        if let Some(mut frame) = self.frame.take() {
+            let compressed = zstd::bulk::compress(&self.buf, self.level)?;
+            self.w.write_all(&compressed)?;
+            frame.offset = self.offset;
+            frame.compressed_size = compressed.len() as u64;
+            self.offset += frame.compressed_size;
+            self.index.push(frame);
+            self.buf.clear();
+        }
+        Ok(())
+    }
+}
+
+/// Random access to the packets of an archive, see the [module docs](self)
+#[derive(Debug)]
+pub struct ArchiveReader<R: Read + Seek> {
+    r: R,
+    index: Vec<ArchiveFrame>,
+}
+
+impl<R: Read + Seek> ArchiveReader<R> {
+    /// Read the archive's index
+    pub fn open(mut r: R) -> Result<Self, Error> {
+        let len = r.seek(SeekFrom::End(0))?;
+        let min_len = (ARCHIVE_MAGIC.len() + FOOTER_SIZE) as u64;
+        if len < min_len {
+            return Err(Error::InvalidArchive("too short"));
+        }
+
+        let mut magic = [0_u8; ARCHIVE_MAGIC.len()];
+        r.seek(SeekFrom::Start(0))?;
+        r.read_exact(&mut magic)?;
+        if magic != ARCHIVE_MAGIC {
+            return Err(Error::InvalidArchive("bad magic number"));
+        }
+
+        let mut footer = [0_u8; FOOTER_SIZE];
+        r.seek(SeekFrom::Start(len - FOOTER_SIZE as u64))?;
+        r.read_exact(&mut footer)?;
+        if footer[24..] != ARCHIVE_MAGIC {
+            return Err(Error::InvalidArchive("bad footer magic number"));
+        }
+        // SAFETY: the footer is FOOTER_SIZE bytes
+        let u64_at = |i: usize| u64::from_le_bytes(footer[i..i + 8].try_into().unwrap());
+        let (index_offset, index_size, frames) = (u64_at(0), u64_at(8), u64_at(16));
+        if index_offset < ARCHIVE_MAGIC.len() as u64
+            || index_offset.checked_add(index_size) != Some(len - FOOTER_SIZE as u64)
+        {
+            return Err(Error::InvalidArchive("index out of bounds"));
+        }
+
+        let entries_size = frames
+            .checked_mul(INDEX_ENTRY_SIZE as u64)
+            .ok_or(Error::InvalidArchive("index size mismatch"))?;
+        r.seek(SeekFrom::Start(index_offset))?;
+        let entries = decompress_exact(&mut r, index_size, entries_size, "index size mismatch")?;
+        let index: Vec<ArchiveFrame> = entries
+            .chunks_exact(INDEX_ENTRY_SIZE)
+            .map(ArchiveFrame::decode)
+            .collect();
+        if index.iter().any(|f| {
+            f.offset < ARCHIVE_MAGIC.len() as u64
+                || f.offset.saturating_add(f.compressed_size) > index_offset
+        }) {
+            return Err(Error::InvalidArchive("frame out of bounds"));
+        }
+
+        Ok(Self { r, index })
+    }
+
+    pub fn index(&self) -> &[ArchiveFrame] {
+        &self.index
+    }
+
+    /// Decompress the packets of the frame at `index` in [`ArchiveReader::index`]
+    pub fn read_frame(&mut self, index: usize) -> Result<Vec<u8>, Error> {
+        let frame = self
+            .index
+            .get(index)
+            .ok_or(Error::InvalidArchive("no such frame"))?;
+        self.r.seek(SeekFrom::Start(frame.offset))?;
+        decompress_exact(
+            &mut self.r,
+            frame.compressed_size,
+            frame.size,
+            "frame size mismatch",
+        )
+    }
+
+    /// Copy the packets selected by `filter` to `w`, byte for byte, like
+    /// [`Parser::slice`]. Only the frames that [overlap](ArchiveFrame::overlaps)
+    /// `filter` are decompressed, [`SliceSummary::packets_read`] counts their packets.
+    pub fn extract<W: Write>(
+        &mut self,
+        parser: &Parser,
+        filter: &PacketFilter,
+        mut w: W,
+    ) -> Result<SliceSummary, Error> {
+        let mut summary = SliceSummary::default();
+        for i in 0..self.index.len() {
+            if !self.index[i].overlaps(filter) {
+                continue;
+            }
+            let packets = self.read_frame(i)?;
+            let s = parser.slice(packets.as_slice(), &mut w, filter)?;
+            summary.packets_read += s.packets_read;
+            summary.packets_written += s.packets_written;
+            summary.bytes_written += s.bytes_written;
+        }
+        Ok(summary)
+    }
+}
+
+/// Decompress `compressed_size` bytes of `r`, expected to decompress to `size` bytes.
+/// Both sizes come from the archive and aren't trusted: memory only grows with the
+/// actual output, up to `size`. A size mismatch is an [`Error::InvalidArchive`] with
+/// the `mismatch` reason.
+fn decompress_exact<R: Read>(
+    r: R,
+    compressed_size: u64,
+    size: u64,
+    mismatch: &'static str,
+) -> Result<Vec<u8>, Error> {
+    let mut out = Vec::new();
+    zstd::Decoder::new(r.take(compressed_size))?
+        .take(size.saturating_add(1))
+        .read_to_end(&mut out)?;
+    if out.len() as u64 != size {
+        return Err(Error::InvalidArchive(mismatch));
+    }
+    Ok(out)
+}
+
+impl Parser {
+    /// Append the packets of `r` to the archive `w`, returning the number of packets.
+    ///
+    /// Like [`Parser::slice`], only the packet headers and contexts are decoded.
+    pub fn archive<R: Read, W: Write>(
+        &self,
+        mut r: R,
+        w: &mut ArchiveWriter<W>,
+    ) -> Result<u64, Error> {
+        let mut packets = 0;
+        let mut packet = Vec::new();
+        while let Some((header, context, remaining)) = self.read_preamble(&mut r, &mut packet)? {
+            let copied = (&mut r).take(remaining).read_to_end(&mut packet)?;
+            if copied as u64 != remaining {
+                return Err(io::Error::from(io::ErrorKind::UnexpectedEof).into());
+            }
+            w.write_packet(&header, &context, &packet)?;
+            packets += 1;
+        }
+        Ok(packets)
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use internment::Intern;
+
+    #[test]
+    fn index_entry_round_trip() {
+        let frame = ArchiveFrame {
+            offset: 8,
+            compressed_size: 100,
+            size: 4096,
+            packets: 4,
+            stream_id: 2,
+            sequence_numbers: Some(3..=6),
+            timestamps: None,
+        };
+        let mut entry = Vec::new();
+        frame.encode(&mut entry);
+        assert_eq!(entry.len(), INDEX_ENTRY_SIZE);
+        assert_eq!(ArchiveFrame::decode(&entry), frame);
+
+        assert!(frame.overlaps(&PacketFilter::default()));
+        assert!(frame.overlaps(&PacketFilter {
+            sequence_numbers: Some(6..=10),
+            timestamps: Some(0..=1),
+            ..Default::default()
+        }));
+        assert!(!frame.overlaps(&PacketFilter {
+            sequence_numbers: Some(7..=10),
+            ..Default::default()
+        }));
+        assert!(!frame.overlaps(&PacketFilter {
+            streams: Some(vec![0, 1]),
+            ..Default::default()
+        }));
+    }
+
+    #[test]
+    fn invalid_archives() {
+        let empty = ArchiveWriter::new(Vec::new()).finish().unwrap();
+        let reader = ArchiveReader::open(io::Cursor::new(empty.clone())).unwrap();
+        assert!(reader.index().is_empty());
+
+        let mut bad = empty.clone();
+        bad[0] = 0;
+        assert!(matches!(
+            ArchiveReader::open(io::Cursor::new(bad)),
+            Err(Error::InvalidArchive(_))
+        ));
+        assert!(matches!(
+            ArchiveReader::open(io::Cursor::new(&empty[..empty.len() - 1])),
+            Err(Error::InvalidArchive(_))
+        ));
+    }
+
+    /// An archive of two one-packet frames
+    fn archive() -> Vec<u8> {
+        let header = PacketHeader {
+            magic_number: None,
+            trace_uuid: None,
+            stream_id: 0,
+            stream_name: Intern::new("s".to_owned()),
+            clock_name: None,
+            clock_type: None,
+        };
+        let context = PacketContext {
+            packet_size_bits: 4096 * 8,
+            content_size_bits: 4096 * 8,
+            beginning_timestamp: None,
+            end_timestamp: None,
+            events_discarded: None,
+            sequence_number: None,
+            extra_members: Vec::new(),
+        };
+        let mut w = ArchiveWriter::new(Vec::new()).with_frame_size(4096);
+        for i in 0..2_u8 {
+            w.write_packet(&header, &context, &[i; 4096]).unwrap();
+        }
+        w.finish().unwrap()
+    }
+
+    /// Replace the index of `archive`
+    fn with_index(archive: &[u8], index: &[ArchiveFrame]) -> Vec<u8> {
+        let footer = &archive[archive.len() - FOOTER_SIZE..];
+        let index_offset = u64::from_le_bytes(footer[..8].try_into().unwrap());
+        let mut out = archive[..index_offset as usize].to_vec();
+        let mut entries = Vec::new();
+        for frame in index {
+            frame.encode(&mut entries);
+        }
+        let entries = zstd::bulk::compress(&entries, 3).unwrap();
+        out.extend_from_slice(&entries);
+        for v in [index_offset, entries.len() as u64, index.len() as u64] {
+            out.extend_from_slice(&v.to_le_bytes());
+        }
+        out.extend_from_slice(&ARCHIVE_MAGIC);
+        out
+    }
+
+    #[test]
+    fn corrupt_index() {
+        let archive = archive();
+        let mut reader = ArchiveReader::open(io::Cursor::new(archive.clone())).unwrap();
+        let index = reader.index().to_vec();
+        assert_eq!(index.len(), 2);
+        assert_eq!(reader.read_frame(1).unwrap(), [1; 4096]);
+
+        let open = |index: &[ArchiveFrame]| {
+            ArchiveReader::open(io::Cursor::new(with_index(&archive, index)))
+        };
+
+        // Frames past the index
+        let mut bad = index.clone();
+        bad[1].compressed_size = u64::MAX / 2;
+        assert!(matches!(open(&bad), Err(Error::InvalidArchive(_))));
+        let mut bad = index.clone();
+        bad[0].offset = 0;
+        assert!(matches!(open(&bad), Err(Error::InvalidArchive(_))));
+
+        // Sizes that don't match the frame contents, without allocating them
+        let mut bad = index.clone();
+        bad[0].size = 1 << 40;
+        bad[1].size = 10;
+        let mut reader = open(&bad).unwrap();
+        assert!(matches!(
+            reader.read_frame(0),
+            Err(Error::InvalidArchive("frame size mismatch"))
+        ));
+        assert!(matches!(
+            reader.read_frame(1),
+            Err(Error::InvalidArchive("frame size mismatch"))
+        ));
+
+        // Frame count that doesn't match the index entries
+        let mut bad = with_index(&archive, &index);
+        let count = bad.len() - ARCHIVE_MAGIC.len() - 8;
+        bad[count..count + 8].copy_from_slice(&u64::MAX.to_le_bytes());
+        assert!(matches!(
+            ArchiveReader::open(io::Cursor::new(bad)),
+            Err(Error::InvalidArchive("index size mismatch"))
+        ));
+
+        // Truncated, the footer no longer locates the index
+        let mut truncated = archive[..100].to_vec();
+        truncated.extend_from_slice(&archive[archive.len() - FOOTER_SIZE..]);
+        assert!(matches!(
+            ArchiveReader::open(io::Cursor::new(truncated)),
+            Err(Error::InvalidArchive("index out of bounds"))
+        ));
+    }
+}
@@ -0,0 +1,678 @@
+//! Build-time generation of typed, schema-specialized event decoders.
+//!
+//! [`generate`] turns a barectf effective configuration into Rust source,
+//! meant to be written out from a `build.rs` and `include!`'d:
+//!
+//! ```ignore
+//! // build.rs
+//! let cfg: barectf_parser::Config = serde_yaml::from_str(&std::fs::read_to_string("effective_config.yaml")?)?;
+//! let out = std::path::Path::new(&std::env::var("OUT_DIR")?).join("trace.rs");
+//! std::fs::write(out, barectf_parser::codegen::generate(&cfg)?)?;
+//!
+//! // src/lib.rs
+//! mod trace {
+//!     include!(concat!(env!("OUT_DIR"), "/trace.rs"));
+//! }
+//! ```
+//!
+//! Each data stream type gets a module with a struct per event record type,
+//! a `CommonContext` struct, an `Event` enum of all the event structs and a
+//! `decode_event` function reading one event record from an [`EventReader`].
+//! Field widths, alignments and the byte order are baked into the generated
+//! code as constants.
+//! Packet headers and contexts are still parsed with
+//! [`Parser::parse_packet_preamble`](crate::Parser::parse_packet_preamble).
+//!
+//! Field types map to `u8`..`u64`, `i8`..`i64`, `f32`/`f64` and `Cow<str>`,
+//! enumerations keep their integer type and get a `<member>_label` method.
+//! Static arrays map to `[T; N]`, dynamic arrays to `Vec<T>`.
+//! Payload members sharing a name with a specific context member are
+//! prefixed with `payload_`.
+
+use crate::{
+    config::{
+        Config, EnumerationFieldType, EnumerationFieldTypeMappingSequence, NativeByteOrder,
+        PrimitiveFieldType, StructureFieldType, StructureMemberFieldType, UnsignedIntegerFieldType,
+    },
+    error::Error,
+    parser::types::{FieldDesc, Size},
+};
+use itertools::Itertools;
+use std::collections::BTreeSet;
+
+pub use reader::EventReader;
+
+mod reader;
+
+/// Generate the Rust source of the typed decoders for `cfg`
+pub fn generate(cfg: &Config) -> Result<String, Error> {
+    let mut g = Generator {
+        out: String::new(),
+        byte_order: match cfg.trace.typ.native_byte_order {
+            NativeByteOrder::LittleEndian => "le",
+            NativeByteOrder::BigEndian => "be",
+        },
+    };
+
+    g.line(0, "// @generated by barectf_parser::codegen, do not edit");
+
+    // NOTE: barectf generates stream IDs based on alphabetical order of stream name
+    let mut modules = BTreeSet::new();
+    for (stream_id, (stream_name, stream)) in cfg
+        .trace
+        .typ
+        .data_stream_types
+        .iter()
+        .sorted_by_key(|(name, _)| name.as_str())
+        .enumerate()
+    {
+        let module = unique(&mut modules, ident(stream_name));
+        let common_context = stream
+            .event_record_common_context_field_type
+            .as_ref()
+            .map(|ft| {
+                Struct::new(
+                    &format!("stream.{stream_name}.event-record-common-context-field-type"),
+                    &[ft],
+                )
+            })
+            .transpose()?
+            .unwrap_or_default();
+
+        // NOTE: barectf generates event IDs based on alphabetical order of event name
+        let mut type_names: BTreeSet<String> = ["CommonContext", "Event", "Record"]
+            .into_iter()
+            .map(str::to_owned)
+            .collect();
+        let mut events = Vec::new();
+        for (event_id, (event_name, event)) in stream
+            .event_record_types
+            .iter()
+            .sorted_by_key(|(name, _)| name.as_str())
+            .enumerate()
+        {
+            let sections: Vec<&StructureFieldType> = [
+                event.specific_context_field_type.as_ref(),
+                event.payload_field_type.as_ref(),
+            ]
+            .into_iter()
+            .flatten()
+            .collect();
+            events.push((
+                event_id,
+                event_name,
+                unique(&mut type_names, type_ident(event_name)),
+                Struct::new(
+                    &format!("stream.{stream_name}.event-record-types.{event_name}"),
+                    &sections,
+                )?,
+            ));
+        }
+
+        let header = [
+            (
+                "id",
+                &stream.features.event_record.type_id_field_type,
+                "type-id-field-type",
+            ),
+            (
+                "timestamp",
+                &stream.features.event_record.timestamp_field_type,
+                "timestamp-field-type",
+            ),
+        ]
+        .into_iter()
+        .map(|(var, ft, path): (_, &UnsignedIntegerFieldType, _)| {
+            FieldDesc::from_ft(&ft.field_type)
+                .map(|desc| (var, desc))
+                .map_err(|e| {
+                    Error::unsupported_ft(
+                        format!("stream.{stream_name}.$features.event-record.{path}"),
+                        e,
+                    )
+                })
+        })
+        .collect::<Result<Vec<_>, Error>>()?;
+        let header_alignment = Size::from_bits(stream.features.event_record.alignment())
+            .ok_or_else(|| {
+                Error::unsupported_alignment(format!("stream.{stream_name}.$features.event-record"))
+            })?;
+
+        g.line(0, "");
+        g.line(0, &format!("/// `{stream_name}` data stream type"));
+        g.line(
+            0,
+            "#[allow(non_camel_case_types, dead_code, unreachable_code, unused_variables, clippy::all)]",
+        );
+        g.line(0, &format!("pub mod {module} {{"));
+        g.line(1, "use barectf_parser::{codegen::EventReader, Error};");
+        g.line(1, "#[allow(unused_imports)]");
+        g.line(1, "use std::borrow::Cow;");
+        g.line(0, "");
+        g.line(1, &format!("pub const STREAM_ID: u64 = {stream_id};"));
+
+        g.emit_struct(
+            "CommonContext",
+            "Event record common context",
+            &common_context,
+            &[],
+        );
+        for (event_id, event_name, type_name, s) in events.iter() {
+            g.emit_struct(
+                type_name,
+                &format!("`{event_name}` event record, specific context and payload"),
+                s,
+                &[
+                    format!("pub const ID: u64 = {event_id};"),
+                    format!("pub const NAME: &'static str = {event_name:?};"),
+                ],
+            );
+        }
+
+        // Event enum
+        let any_borrows = events.iter().any(|(_, _, _, s)| s.borrows());
+        let event_lt = if any_borrows { "<'a>" } else { "" };
+        g.line(0, "");
+        g.line(1, "#[derive(Clone, PartialEq, Debug)]");
+        g.line(1, &format!("pub enum Event{event_lt} {{"));
+        for (_, _, type_name, s) in events.iter() {
+            g.line(2, &format!("{type_name}({type_name}{}),", s.lifetime()));
+        }
+        g.line(1, "}");
+        g.line(0, "");
+        g.line(1, &format!("impl{event_lt} Event{event_lt} {{"));
+        g.line(2, "pub fn id(&self) -> u64 {");
+        g.line(3, "match self {");
+        for (_, _, type_name, _) in events.iter() {
+            g.line(4, &format!("Self::{type_name}(_) => {type_name}::ID,"));
+        }
+        g.line(3, "}");
+        g.line(2, "}");
+        g.line(0, "");
+        g.line(2, "pub fn name(&self) -> &'static str {");
+        g.line(3, "match self {");
+        for (_, _, type_name, _) in events.iter() {
+            g.line(4, &format!("Self::{type_name}(_) => {type_name}::NAME,"));
+        }
+        g.line(3, "}");
+        g.line(2, "}");
+        g.line(1, "}");
+
+        // Event record
+        let record_borrows = any_borrows || common_context.borrows();
+        let record_lt = if record_borrows { "<'a>" } else { "" };
+        g.line(0, "");
+        g.line(1, "/// A decoded event record");
+        g.line(1, "#[derive(Clone, PartialEq, Debug)]");
+        g.line(1, &format!("pub struct Record{record_lt} {{"));
+        g.line(2, "pub timestamp: u64,");
+        g.line(
+            2,
+            &format!(
+                "pub common_context: CommonContext{},",
+                common_context.lifetime()
+            ),
+        );
+        g.line(2, &format!("pub event: Event{event_lt},"));
+        g.line(1, "}");
+        g.line(0, "");
+        g.line(1, "/// Decode the next event record of a packet");
+        g.line(1, "#[inline]");
+        if record_borrows {
+            g.line(
+                1,
+                "pub fn decode_event<'a>(r: &mut EventReader<'a>) -> Result<Record<'a>, Error> {",
+            );
+        } else {
+            g.line(
+                1,
+                "pub fn decode_event(r: &mut EventReader<'_>) -> Result<Record, Error> {",
+            );
+        }
+        g.line(2, &format!("r.align::<{}>()?;", bytes(header_alignment)));
+        for (var, desc) in header.iter() {
+            g.line(
+                2,
+                &format!("let {var} = u64::from({}?);", g.read_int(desc, 'u')),
+            );
+        }
+        g.line(2, "let common_context = CommonContext::decode(r)?;");
+        g.line(2, "let event = match id {");
+        for (event_id, _, type_name, _) in events.iter() {
+            g.line(
+                3,
+                &format!("{event_id} => Event::{type_name}({type_name}::decode(r)?),"),
+            );
+        }
+        g.line(3, "_ => return Err(Error::UndefinedEventId(id)),");
+        g.line(2, "};");
+        g.line(2, "Ok(Record {");
+        g.line(3, "timestamp,");
+        g.line(3, "common_context,");
+        g.line(3, "event,");
+        g.line(2, "})");
+        g.line(1, "}");
+        g.line(0, "}");
+    }
+
+    Ok(g.out)
+}
+
+struct Generator {
+    out: String,
+    /// Read method suffix
+    byte_order: &'static str,
+}
+
+impl Generator {
+    fn line(&mut self, indent: usize, s: &str) {
+        if !s.is_empty() {
+            for _ in 0..indent {
+                self.out.push_str("    ");
+            }
+            self.out.push_str(s);
+        }
+        self.out.push('\n');
+    }
+
+    fn emit_struct(&mut self, type_name: &str, doc: &str, s: &Struct, consts: &[String]) {
+        let lt = s.lifetime();
+        self.line(0, "");
+        self.line(1, &format!("/// {doc}"));
+        self.line(1, "#[derive(Clone, PartialEq, Debug)]");
+        if s.members.is_empty() {
+            self.line(1, &format!("pub struct {type_name} {{}}"));
+        } else {
+            self.line(1, &format!("pub struct {type_name}{lt} {{"));
+            for m in s.members.iter() {
+                self.line(2, &format!("pub {}: {},", m.ident, m.ty.rust_type()));
+            }
+            self.line(1, "}");
+        }
+        self.line(0, "");
+        self.line(1, &format!("impl{lt} {type_name}{lt} {{"));
+        for c in consts.iter() {
+            self.line(2, c);
+        }
+        if !consts.is_empty() {
+            self.line(0, "");
+        }
+        self.line(2, "#[inline]");
+        let reader_lt = if s.borrows() { "'a" } else { "'_" };
+        self.line(
+            2,
+            &format!("pub fn decode(r: &mut EventReader<{reader_lt}>) -> Result<Self, Error> {{"),
+        );
+        for m in s.members.iter() {
+            if let Some(a) = m.section_start {
+                self.line(3, &format!("r.align::<{}>()?;", bytes(a)));
+            }
+            self.emit_read(&m.ident, &m.ty);
+        }
+        // Trailing sections without members still align
+        for a in s.trailing_alignments.iter() {
+            self.line(3, &format!("r.align::<{}>()?;", bytes(*a)));
+        }
+        if s.members.is_empty() {
+            self.line(3, "Ok(Self {})");
+        } else {
+            self.line(3, "Ok(Self {");
+            for m in s.members.iter() {
+                self.line(4, &format!("{},", m.ident));
+            }
+            self.line(3, "})");
+        }
+        self.line(2, "}");
+
+        for m in s.members.iter() {
+            if let Ty::Enum(signed, desc, mappings) = &m.ty {
+                self.line(0, "");
+                self.line(2, &format!("/// Label of the `{}` value, if any", m.name));
+                self.line(2, "#[allow(unreachable_patterns)]");
+                self.line(
+                    2,
+                    &format!(
+                        "pub fn {}_label(&self) -> Option<&'static str> {{",
+                        m.ident.trim_start_matches("r#")
+                    ),
+                );
+                self.line(3, &format!("match self.{} {{", m.ident));
+                for (label, first, last) in enum_arms(*signed, desc.size, mappings) {
+                    let pat = if first == last {
+                        first.to_string()
+                    } else {
+                        format!("{first}..={last}")
+                    };
+                    self.line(4, &format!("{pat} => Some({label:?}),"));
+                }
+                self.line(4, "_ => None,");
+                self.line(3, "}");
+                self.line(2, "}");
+            }
+        }
+        self.line(1, "}");
+    }
+
+    /// Statements reading a value of type `ty` into `ident`
+    fn emit_read(&mut self, ident: &str, ty: &Ty) {
+        let read = match ty {
+            Ty::Prim(p) => self.read_prim(p),
+            Ty::Enum(signed, desc, _) => self.read_int(desc, if *signed { 'i' } else { 'u' }),
+            Ty::StaticArray(len, p) => format!("r.array::<_, {len}>(|r| {})", self.read_prim(p)),
+            Ty::DynamicArray(p) => {
+                // NOTE: the u32 len field is always byte-packed
+                let len = format!("let len = r.u32_{}::<1>()? as usize;", self.byte_order);
+                let align = format!("r.align::<{}>()?;", bytes(p.desc().alignment));
+                let elements = format!("r.vec(len, |r| {})?", self.read_prim(p));
+                self.line(3, &format!("let {ident} = {{"));
+                self.line(4, &len);
+                self.line(4, &align);
+                self.line(4, &elements);
+                self.line(3, "};");
+                return;
+            }
+        };
+        self.line(3, &format!("let {ident} = {read}?;"));
+    }
+
+    fn read_prim(&self, p: &Prim) -> String {
+        match p {
+            Prim::UInt(desc) => self.read_int(desc, 'u'),
+            Prim::Int(desc) => self.read_int(desc, 'i'),
+            Prim::Real(desc) => self.read_int(desc, 'f'),
+            Prim::Enum(signed, desc) => self.read_int(desc, if *signed { 'i' } else { 'u' }),
+            Prim::String => "r.str()".to_owned(),
+        }
+    }
+
+    fn read_int(&self, desc: &FieldDesc, kind: char) -> String {
+        format!(
+            "r.{kind}{}_{}::<{}>()",
+            bits(desc.size),
+            self.byte_order,
+            bytes(desc.alignment)
+        )
+    }
+}
+
+/// The members of one or more consecutive structure field types
+#[derive(Default)]
+struct Struct {
+    members: Vec<Member>,
+    /// Alignments of the trailing structures without members
+    trailing_alignments: Vec<Size>,
+}
+
+struct Member {
+    name: String,
+    ident: String,
+    ty: Ty,
+    /// Alignment of the structure this member starts, if it's the first one
+    section_start: Option<Size>,
+}
+
+impl Struct {
+    fn new(path: &str, sections: &[&StructureFieldType]) -> Result<Self, Error> {
+        let mut s = Self::default();
+        let mut idents = BTreeSet::new();
+        let mut pending: Vec<Size> = Vec::new();
+        for (index, section) in sections.iter().enumerate() {
+            let alignment = Size::from_bits(section.alignment())
+                .ok_or_else(|| Error::unsupported_alignment(path))?;
+            pending.push(alignment);
+            for (member_name, member) in section.members.iter().flat_map(|m| m.iter()) {
+                let ty = Ty::new(&member.field_type).map_err(|e| match e {
+                    TyError::Unsupported(e) => {
+                        Error::unsupported_ft(format!("{path}.{member_name}"), e)
+                    }
+                    TyError::Float(bits) => Error::InvalidFloatSize(bits),
+                })?;
+                let mut ident = ident(member_name);
+                if index > 0 && idents.contains(&ident) {
+                    ident = format!("payload_{}", ident.trim_start_matches("r#"));
+                }
+                let ident = unique(&mut idents, ident);
+                // Sections without members only align, fold them into the next member
+                let section_start = pending.drain(..).max();
+                s.members.push(Member {
+                    name: member_name.clone(),
+                    ident,
+                    ty,
+                    section_start,
+                });
+            }
+        }
+        s.trailing_alignments = pending;
+        Ok(s)
+    }
+
+    /// True when a decoded value borrows from the packet buffer
+    fn borrows(&self) -> bool {
+        self.members.iter().any(|m| m.ty.borrows())
+    }
+
+    fn lifetime(&self) -> &'static str {
+        if self.borrows() {
+            "<'a>"
+        } else {
+            ""
+        }
+    }
+}
+
+/// Primitive field types
+enum Prim {
+    UInt(FieldDesc),
+    Int(FieldDesc),
+    Real(FieldDesc),
+    /// (signed, desc)
+    Enum(bool, FieldDesc),
+    String,
+}
+
+enum Ty {
+    Prim(Prim),
+    /// (signed, desc, mappings), kept apart from [`Prim::Enum`] to generate label methods
+    Enum(bool, FieldDesc, EnumerationFieldType),
+    StaticArray(usize, Prim),
+    DynamicArray(Prim),
+}
+
+enum TyError {
+    Unsupported(crate::parser::types::FieldUnsupportedError),
+    Float(usize),
+}
+
+impl Prim {
+    fn new(ft: &PrimitiveFieldType) -> Result<Self, TyError> {
+        let desc = FieldDesc::from_ft(ft).map_err(TyError::Unsupported)?;
+        Ok(match ft {
+            PrimitiveFieldType::UnsignedInteger(_) => Self::UInt(desc),
+            PrimitiveFieldType::SignedInteger(_) => Self::Int(desc),
+            PrimitiveFieldType::String => Self::String,
+            PrimitiveFieldType::Real(_) => {
+                if !matches!(desc.size, Size::Bits32 | Size::Bits64) {
+                    return Err(TyError::Float(bits(desc.size)));
+                }
+                Self::Real(desc)
+            }
+            PrimitiveFieldType::UnsignedEnumeration(_) => Self::Enum(false, desc),
+            PrimitiveFieldType::SignedEnumeration(_) => Self::Enum(true, desc),
+        })
+    }
+
+    fn desc(&self) -> FieldDesc {
+        match self {
+            Self::UInt(d) | Self::Int(d) | Self::Real(d) | Self::Enum(_, d) => *d,
+            Self::String => FieldDesc {
+                size: Size::Bits8,
+                alignment: Size::Bits8,
+            },
+        }
+    }
+
+    fn rust_type(&self) -> String {
+        match self {
+            Self::UInt(d) => format!("u{}", bits(d.size)),
+            Self::Int(d) => format!("i{}", bits(d.size)),
+            Self::Real(d) => format!("f{}", bits(d.size)),
+            Self::Enum(signed, d) => format!("{}{}", if *signed { 'i' } else { 'u' }, bits(d.size)),
+            Self::String => "Cow<'a, str>".to_owned(),
+        }
+    }
+}
+
+impl Ty {
+    fn new(ft: &StructureMemberFieldType) -> Result<Self, TyError> {
+        Ok(match ft {
+            StructureMemberFieldType::UnsignedInteger(t) => {
+                Self::Prim(Prim::new(&PrimitiveFieldType::UnsignedInteger(t.clone()))?)
+            }
+            StructureMemberFieldType::SignedInteger(t) => {
+                Self::Prim(Prim::new(&PrimitiveFieldType::SignedInteger(t.clone()))?)
+            }
+            StructureMemberFieldType::String => Self::Prim(Prim::String),
+            StructureMemberFieldType::Real(t) => {
+                Self::Prim(Prim::new(&PrimitiveFieldType::Real(t.clone()))?)
+            }
+            StructureMemberFieldType::UnsignedEnumeration(t) => {
+                let desc = FieldDesc::from_ft(ft).map_err(TyError::Unsupported)?;
+                Self::Enum(false, desc, t.clone())
+            }
+            StructureMemberFieldType::SignedEnumeration(t) => {
+                let desc = FieldDesc::from_ft(ft).map_err(TyError::Unsupported)?;
+                Self::Enum(true, desc, t.clone())
+            }
+            StructureMemberFieldType::StaticArray(t) => {
+                Self::StaticArray(t.length, Prim::new(&t.element_field_type)?)
+            }
+            StructureMemberFieldType::DynamicArray(t) => {
+                Self::DynamicArray(Prim::new(&t.element_field_type)?)
+            }
+        })
+    }
+
+    fn borrows(&self) -> bool {
+        match self {
+            Self::Prim(p) | Self::StaticArray(_, p) | Self::DynamicArray(p) => {
+                matches!(p, Prim::String)
+            }
+            Self::Enum(..) => false,
+        }
+    }
+
+    fn rust_type(&self) -> String {
+        match self {
+            Self::Prim(p) => p.rust_type(),
+            Self::Enum(signed, d, _) => {
+                format!("{}{}", if *signed { 'i' } else { 'u' }, bits(d.size))
+            }
+            Self::StaticArray(len, p) => format!("[{}; {len}]", p.rust_type()),
+            Self::DynamicArray(p) => format!("Vec<{}>", p.rust_type()),
+        }
+    }
+}
+
+/// Match arms `(label, first, last)` of an enumeration label lookup, in
+/// priority order, clamped to the range of the field's integer type
+fn enum_arms(signed: bool, size: Size, ft: &EnumerationFieldType) -> Vec<(String, i128, i128)> {
+    let (min, max) = if signed {
+        (
+            -(1_i128 << (bits(size) - 1)),
+            (1_i128 << (bits(size) - 1)) - 1,
+        )
+    } else {
+        (0, (1_i128 << bits(size)) - 1)
+    };
+    let mut arms = Vec::new();
+    for (label, seq) in ft.mappings.iter() {
+        for s in seq.iter() {
+            let (first, last) = match s {
+                EnumerationFieldTypeMappingSequence::InclusiveRange(first, last) => (*first, *last),
+                EnumerationFieldTypeMappingSequence::Value(v) => (*v, *v),
+            };
+            let (first, last) = (i128::from(first).max(min), i128::from(last).min(max));
+            if first <= last {
+                arms.push((label.clone(), first, last));
+            }
+        }
+    }
+    arms
+}
+
+fn bits(size: Size) -> usize {
+    match size {
+        Size::Bits8 => 8,
+        Size::Bits16 => 16,
+        Size::Bits32 => 32,
+        Size::Bits64 => 64,
+    }
+}
+
+fn bytes(size: Size) -> usize {
+    bits(size) >> 3
+}
+
+const KEYWORDS: &[&str] = &[
+    "as", "async", "await", "break", "const", "continue", "dyn", "else", "enum", "extern", "false",
+    "fn", "for", "gen", "if", "impl", "in", "let", "loop", "match", "mod", "move", "mut", "pub",
+    "ref", "return", "static", "struct", "trait", "true", "try", "type", "unsafe", "use", "where",
+    "while", "abstract", "become", "box", "do", "final", "macro", "override", "priv", "typeof",
+    "unsized", "virtual", "yield",
+];
+
+/// A snake_case-ish identifier for a member or module name
+fn ident(name: &str) -> String {
+    let mut s: String = name
+        .chars()
+        .map(|c| {
+            if c.is_ascii_alphanumeric() {
+                c.to_ascii_lowercase()
+            } else {
+                '_'
+            }
+        })
+        .collect();
+    if s.is_empty() || s.starts_with(|c: char| c.is_ascii_digit()) {
+        s.insert(0, '_');
+    }
+    if s == "_" || matches!(s.as_str(), "self" | "super" | "crate") {
+        s.push('_');
+    } else if KEYWORDS.contains(&s.as_str()) {
+        s.insert_str(0, "r#");
+    }
+    s
+}
+
+/// A CamelCase type name for an event name
+fn type_ident(name: &str) -> String {
+    let mut s: String = name
+        .split(|c: char| !c.is_ascii_alphanumeric())
+        .filter(|w| !w.is_empty())
+        .map(|w| {
+            let mut chars = w.chars();
+            // SAFETY: words are non-empty
+            let first = chars.next().unwrap().to_ascii_uppercase();
+            std::iter::once(first).chain(chars).collect::<String>()
+        })
+        .collect();
+    if s.is_empty() || s.starts_with(|c: char| c.is_ascii_digit()) {
+        s.insert(0, 'E');
+    }
+    if s == "Self" {
+        s.push_str("Event");
+    }
+    s
+}
+
+/// Suffix `name` until it's not in `taken`
+fn unique(taken: &mut BTreeSet<String>, name: String) -> String {
+    let mut candidate = name.clone();
+    let mut n = 1;
+    while taken.contains(&candidate) {
+        candidate = format!("{name}{n}");
+        n += 1;
+    }
+    taken.insert(candidate.clone());
+    candidate
+}
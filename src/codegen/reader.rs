@@ -0,0 +1,158 @@
+use crate::error::Error;
+use std::{borrow::Cow, io};
+
+/// Event record reader used by the decoders emitted by [`generate`](super::generate).
+///
+/// Reads from a packet buffer, positions are byte offsets from the start
+/// of the packet, which is what alignment is relative to.
+/// Field widths and alignments are const parameters so each call site
+/// compiles down to a fixed-size load.
+#[derive(Clone, Debug)]
+pub struct EventReader<'a> {
+    buf: &'a [u8],
+    pos: usize,
+}
+
+impl<'a> EventReader<'a> {
+    /// Read the events of `packet`, truncated to its content size,
+    /// starting at byte offset `pos`.
+    /// See [`Parser::parse_packet_preamble`](crate::Parser::parse_packet_preamble).
+    pub fn new(packet: &'a [u8], pos: usize) -> Self {
+        Self { buf: packet, pos }
+    }
+
+    pub fn position(&self) -> usize {
+        self.pos
+    }
+
+    /// True once all of the packet content has been read
+    pub fn is_empty(&self) -> bool {
+        self.pos >= self.buf.len()
+    }
+
+    #[inline(always)]
+    pub fn align<const A: usize>(&mut self) -> Result<(), Error> {
+        let pos = self.pos.next_multiple_of(A);
+        if pos > self.buf.len() {
+            return Err(eof());
+        }
+        self.pos = pos;
+        Ok(())
+    }
+
+    #[inline(always)]
+    fn take<const A: usize, const N: usize>(&mut self) -> Result<[u8; N], Error> {
+        self.align::<A>()?;
+        let bytes = self
+            .buf
+            .get(self.pos..self.pos + N)
+            .ok_or_else(eof)?
+            .try_into()
+            .unwrap(); // SAFETY: the range is N bytes
+        self.pos += N;
+        Ok(bytes)
+    }
+
+    /// Read a NUL-terminated string, borrowed unless it isn't valid UTF-8
+    #[inline]
+    pub fn str(&mut self) -> Result<Cow<'a, str>, Error> {
+        let rest = &self.buf[self.pos..];
+        let len = memchr::memchr(0, rest).ok_or_else(eof)?;
+        // Includes the NUL terminator
+        self.pos += len + 1;
+        Ok(String::from_utf8_lossy(&rest[..len]))
+    }
+
+    /// Read `N` elements with `f`, in place.
+    /// The elements following a failed read are defaulted, then dropped.
+    #[inline]
+    pub fn array<T: Default, const N: usize>(
+        &mut self,
+        mut f: impl FnMut(&mut Self) -> Result<T, Error>,
+    ) -> Result<[T; N], Error> {
+        let mut res = Ok(());
+        let arr = std::array::from_fn(|_| {
+            if res.is_ok() {
+                match f(self) {
+                    Ok(v) => return v,
+                    Err(e) => res = Err(e),
+                }
+            }
+            T::default()
+        });
+        res.map(|_| arr)
+    }
+
+    /// Read `len` elements with `f`
+    #[inline]
+    pub fn vec<T>(
+        &mut self,
+        len: usize,
+        mut f: impl FnMut(&mut Self) -> Result<T, Error>,
+    ) -> Result<Vec<T>, Error> {
+        // Don't trust the length prefix with the allocation size
+        let mut v = Vec::with_capacity(len.min(self.buf.len() - self.pos));
+        for _ in 0..len {
+            v.push(f(self)?);
+        }
+        Ok(v)
+    }
+}
+
+macro_rules! impl_read {
+    ($($le:ident, $be:ident, $t:ty);* $(;)?) => {
+        impl EventReader<'_> {
+            $(
+                #[inline(always)]
+                pub fn $le<const A: usize>(&mut self) -> Result<$t, Error> {
+                    Ok(<$t>::from_le_bytes(self.take::<A, { size_of::<$t>() }>()?))
+                }
+
+                #[inline(always)]
+                pub fn $be<const A: usize>(&mut self) -> Result<$t, Error> {
+                    Ok(<$t>::from_be_bytes(self.take::<A, { size_of::<$t>() }>()?))
+                }
+            )*
+        }
+    };
+}
+
+impl_read!(
+    u8_le, u8_be, u8;
+    i8_le, i8_be, i8;
+    u16_le, u16_be, u16;
+    i16_le, i16_be, i16;
+    u32_le, u32_be, u32;
+    i32_le, i32_be, i32;
+    u64_le, u64_be, u64;
+    i64_le, i64_be, i64;
+    f32_le, f32_be, f32;
+    f64_le, f64_be, f64;
+);
+
+fn eof() -> Error {
+    io::Error::from(io::ErrorKind::UnexpectedEof).into()
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    #[test]
+    fn static_array() {
+        let buf = [1, 0, 2, 0, 3, 0];
+        let mut r = EventReader::new(&buf, 0);
+        assert_eq!(r.array::<_, 3>(|r| r.u16_le::<2>()).unwrap(), [1, 2, 3]);
+        assert!(r.is_empty());
+
+        // Stops at the first failed read
+        let mut r = EventReader::new(&buf, 2);
+        let mut reads = 0;
+        let res = r.array::<_, 4>(|r| {
+            reads += 1;
+            r.u16_le::<2>()
+        });
+        assert!(res.is_err());
+        assert_eq!(reads, 3);
+    }
+}
@@ -0,0 +1,302 @@
+//! Transparent decompression of compressed stream files.
+//!
+//! [`DecompressReader`] and [`AsyncDecompressReader`] detect the input's compression
+//! from its first bytes and decompress it on a background thread, a few chunks ahead
+//! of the decoder reading from them. Uncompressed input is passed through, still read
+//! ahead on the background thread.
+//!
+//! zstd requires the `zstd` feature.
+
+use std::{
+    io::{self, Read},
+    pin::Pin,
+    sync::mpsc,
+    task::{ready, Context, Poll},
+    thread,
+};
+use tokio::{
+    io::{AsyncRead, ReadBuf},
+    sync::mpsc as async_mpsc,
+};
+
+/// Size of the chunks handed over by the background thread
+const CHUNK_SIZE: usize = 256 * 1024;
+
+/// Number of chunks the background thread can get ahead of the reader by
+const READ_AHEAD_CHUNKS: usize = 4;
+
+const ZSTD_MAGIC: [u8; 4] = [0x28, 0xB5, 0x2F, 0xFD];
+
+/// Compression formats recognized from the start of a stream file
+#[derive(Copy, Clone, Eq, PartialEq, Ord, PartialOrd, Hash, Debug)]
+pub enum Compression {
+    None,
+    Zstd,
+}
+
+impl Compression {
+    /// Compression of a stream file starting with `prefix`, of at least 4 bytes
+    /// when the file is that long
+    pub fn detect(prefix: &[u8]) -> Self {
+        if prefix.starts_with(&ZSTD_MAGIC) {
+            Compression::Zstd
+        } else {
+            Compression::None
+        }
+    }
+}
+
+/// Decompressed bytes handed over by the background thread, an empty chunk marks
+/// the end of the input
+type Chunk = io::Result<Vec<u8>>;
+
+/// A [`Read`] over the decompressed contents of `r`, see the [module docs](self).
+///
+/// Decompression errors, including unsupported compression, are returned by
+/// the read they would have fed.
+#[derive(Debug)]
+pub struct DecompressReader {
+    rx: mpsc::Receiver<Chunk>,
+    chunk: Vec<u8>,
+    pos: usize,
+    done: bool,
+}
+
+impl DecompressReader {
+    pub fn new<R: Read + Send + 'static>(r: R) -> Self {
+        let (tx, rx) = mpsc::sync_channel(READ_AHEAD_CHUNKS);
+        spawn_reader(r, move |chunk| tx.send(chunk).is_ok());
+        Self {
+            rx,
+            chunk: Vec::new(),
+            pos: 0,
+            done: false,
+        }
+    }
+}
+
+impl Read for DecompressReader {
+    fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
+        if self.done {
+            return Ok(0);
+        }
+        if self.pos == self.chunk.len() {
+            match self.rx.recv() {
+                Ok(chunk) => {
+                    self.chunk = chunk?;
+                    self.pos = 0;
+                    self.done = self.chunk.is_empty();
+                }
+                Err(_) => return Err(thread_gone()),
+            }
+        }
+        let n = buf.len().min(self.chunk.len() - self.pos);
+        buf[..n].copy_from_slice(&self.chunk[self.pos..self.pos + n]);
+        self.pos += n;
+        Ok(n)
+    }
+}
+
+/// An [`AsyncRead`] over the decompressed contents of `r`, e.g. for driving a
+/// [`PacketDecoder`](crate::PacketDecoder) through a `FramedRead`.
+/// See [`DecompressReader`].
+#[derive(Debug)]
+pub struct AsyncDecompressReader {
+    rx: async_mpsc::Receiver<Chunk>,
+    chunk: Vec<u8>,
+    pos: usize,
+    done: bool,
+}
+
+impl AsyncDecompressReader {
+    pub fn new<R: Read + Send + 'static>(r: R) -> Self {
+        let (tx, rx) = async_mpsc::channel(READ_AHEAD_CHUNKS);
+        spawn_reader(r, move |chunk| tx.blocking_send(chunk).is_ok());
+        Self {
+            rx,
+            chunk: Vec::new(),
+            pos: 0,
+            done: false,
+        }
+    }
+}
+
+impl AsyncRead for AsyncDecompressReader {
+    fn poll_read(
+        mut self: Pin<&mut Self>,
+        cx: &mut Context<'_>,
+        buf: &mut ReadBuf<'_>,
+    ) -> Poll<io::Result<()>> {
+        if self.done {
+            return Poll::Ready(Ok(()));
+        }
+        if self.pos == self.chunk.len() {
+            match ready!(self.rx.poll_recv(cx)) {
+                Some(chunk) => {
+                    self.chunk = chunk?;
+                    self.pos = 0;
+                    self.done = self.chunk.is_empty();
+                }
+                None => return Poll::Ready(Err(thread_gone())),
+            }
+        }
+        let n = buf.remaining().min(self.chunk.len() - self.pos);
+        let pos = self.pos;
+        buf.put_slice(&self.chunk[pos..pos + n]);
+        self.pos += n;
+        Poll::Ready(Ok(()))
+    }
+}
+
+/// Read the decompressed contents of `r` on a new thread, handing them to `send`
+/// in chunks until it returns false or the input ends
+fn spawn_reader<R, F>(r: R, mut send: F)
+where
+    R: Read + Send + 'static,
+    F: FnMut(Chunk) -> bool + Send + 'static,
+{
+    thread::spawn(move || {
+        let mut r = match decompressor(r) {
+            Ok(r) => r,
+            Err(e) => {
+                send(Err(e));
+                return;
+            }
+        };
+        loop {
+            let mut chunk = vec![0_u8; CHUNK_SIZE];
+            match r.read(&mut chunk) {
+                Ok(0) => {
+                    send(Ok(Vec::new()));
+                    return;
+                }
+                Ok(n) => {
+                    chunk.truncate(n);
+                    if !send(Ok(chunk)) {
+                        return;
+                    }
+                }
+                Err(e) if e.kind() == io::ErrorKind::Interrupted => (),
+                Err(e) => {
+                    send(Err(e));
+                    return;
+                }
+            }
+        }
+    });
+}
+
+/// The background thread ended without an end of input marker, e.g. it panicked
+/// in the decompressor, rather than let the stream look complete
+fn thread_gone() -> io::Error {
+    io::Error::other("decompression thread ended before the end of the input")
+}
+
+/// Wrap `r` in the decompressor for its detected [`Compression`]
+fn decompressor<R: Read + Send + 'static>(mut r: R) -> io::Result<Box<dyn Read + Send>> {
+    let mut prefix = Vec::with_capacity(ZSTD_MAGIC.len());
+    r.by_ref()
+        .take(ZSTD_MAGIC.len() as u64)
+        .read_to_end(&mut prefix)?;
+    let compression = Compression::detect(&prefix);
+    let r = io::Cursor::new(prefix).chain(r);
+    match compression {
+        Compression::None => Ok(Box::new(r)),
+        #[cfg(feature = "zstd")]
+        Compression::Zstd => Ok(Box::new(zstd::Decoder::new(r)?)),
+        #[cfg(not(feature = "zstd"))]
+        Compression::Zstd => Err(io::Error::new(
+            io::ErrorKind::Unsupported,
+            "zstd compressed input requires the `zstd` feature",
+        )),
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    #[test]
+    fn passthrough_read_ahead() {
+        let data: Vec<u8> = (0..(3 * CHUNK_SIZE + 17)).map(|i| i as u8).collect();
+        let mut out = Vec::new();
+        DecompressReader::new(io::Cursor::new(data.clone()))
+            .read_to_end(&mut out)
+            .unwrap();
+        assert_eq!(out, data);
+
+        // Shorter than the magic number
+        let mut out = Vec::new();
+        DecompressReader::new(io::Cursor::new(vec![0x28, 0xB5]))
+            .read_to_end(&mut out)
+            .unwrap();
+        assert_eq!(out, [0x28, 0xB5]);
+    }
+
+    /// Panics after `n` bytes
+    struct Panicking(usize);
+
+    impl Read for Panicking {
+        fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
+            assert!(self.0 > 0, "input failure");
+            let n = buf.len().min(self.0);
+            buf[..n].fill(1);
+            self.0 -= n;
+            Ok(n)
+        }
+    }
+
+    #[test]
+    fn reader_thread_panic() {
+        let mut out = Vec::new();
+        let err = DecompressReader::new(Panicking(CHUNK_SIZE + 3))
+            .read_to_end(&mut out)
+            .unwrap_err();
+        assert_eq!(err.kind(), io::ErrorKind::Other);
+        // Errors again rather than ending the stream
+        let mut r = DecompressReader::new(Panicking(10));
+        assert!(r.read_to_end(&mut out).is_err());
+        assert!(r.read(&mut [0; 4]).is_err());
+    }
+
+    #[tokio::test]
+    async fn async_reader_thread_panic() {
+        use tokio::io::AsyncReadExt;
+        let mut out = Vec::new();
+        let err = AsyncDecompressReader::new(Panicking(CHUNK_SIZE + 3))
+            .read_to_end(&mut out)
+            .await
+            .unwrap_err();
+        assert_eq!(err.kind(), io::ErrorKind::Other);
+
+        let mut out = Vec::new();
+        AsyncDecompressReader::new(io::Cursor::new(vec![7; 10]))
+            .read_to_end(&mut out)
+            .await
+            .unwrap();
+        assert_eq!(out, [7; 10]);
+    }
+
+    #[cfg(feature = "zstd")]
+    #[test]
+    fn zstd_round_trip() {
+        let data: Vec<u8> = (0..(CHUNK_SIZE + 5)).map(|i| (i / 7) as u8).collect();
+        let compressed = zstd::encode_all(data.as_slice(), 3).unwrap();
+        assert_eq!(Compression::detect(&compressed), Compression::Zstd);
+        let mut out = Vec::new();
+        DecompressReader::new(io::Cursor::new(compressed))
+            .read_to_end(&mut out)
+            .unwrap();
+        assert_eq!(out, data);
+    }
+
+    #[cfg(not(feature = "zstd"))]
+    #[test]
+    fn zstd_unsupported() {
+        let mut out = Vec::new();
+        let err = DecompressReader::new(io::Cursor::new(ZSTD_MAGIC.to_vec()))
+            .read_to_end(&mut out)
+            .unwrap_err();
+        assert_eq!(err.kind(), io::ErrorKind::Unsupported);
+    }
+}
@@ -4,6 +4,7 @@ use crate::{
 };
 use std::io;
 use thiserror::Error;
+use uuid::Uuid;
 
 #[derive(Debug, Error)]
 pub enum Error {
@@ -22,6 +23,24 @@ pub enum Error {
     #[error("Encountered a CTF event ID ({0}) that's not defined in the schema")]
     UndefinedEventId(EventId),
 
+    #[error("Encountered an invalid packet header magic number (0x{0:X})")]
+    InvalidMagicNumber(u32),
+
+    #[error("Encountered a trace type UUID ({0}) that doesn't match the schema")]
+    TraceUuidMismatch(Uuid),
+
+    #[error("Encountered an invalid packet size ({0} bits) or content size ({1} bits)")]
+    InvalidPacketSize(usize, usize),
+
+    #[error("Value(s) for '{0}' don't match the schema")]
+    MismatchedFieldValue(String),
+
+    #[error("Event or packet preamble ({0} bytes) doesn't fit in a {1} byte packet")]
+    EventTooLarge(usize, usize),
+
+    #[error("Encountered an invalid archive ({0})")]
+    InvalidArchive(&'static str),
+
     #[error(
         "Encountered and IO error while reading the input stream ({})",
         .0.kind()
@@ -1,10 +1,19 @@
 #![doc = include_str!("../README.md")]
 
+#[cfg(feature = "zstd")]
+pub use crate::archive::{ArchiveFrame, ArchiveReader, ArchiveWriter};
+pub use crate::compression::{AsyncDecompressReader, Compression, DecompressReader};
 pub use crate::config::*;
 pub use crate::error::Error;
-pub use crate::parser::{PacketDecoder, Parser};
+pub use crate::parser::{
+    EventVisitor, PacketDecoder, PacketFilter, PacketWriter, Parser, SliceSummary,
+};
 pub use crate::types::*;
 
+#[cfg(feature = "zstd")]
+pub mod archive;
+pub mod codegen;
+pub mod compression;
 pub mod config;
 pub mod error;
 pub mod parser;
@@ -1,23 +1,50 @@
+use self::slice::read_fully;
 use self::types::{
-    AlignedCursor, EnumerationMappings, EventHeaderParser, EventParser, EventPayloadMemberParser,
-    EventPayloadParser, FieldTypeParser, PacketContextParser, PacketContextParserArgs,
-    PacketHeaderParser, Size, StreamParser, StreamReader, UIntParser, UuidParser,
+    AlignedCursor, ByteSource, EventHeaderParser, EventParser, EventPayloadMemberParser,
+    EventPayloadParser, PacketContextParser, PacketContextParserArgs, PacketHeaderParser, Size,
+    StreamClocks, StreamParser, StreamReader, StringCache, UIntParser, UuidParser,
 };
 use crate::{
-    config::{ClockType, Config, FieldType, NativeByteOrder},
+    config::{ClockType, Config, NativeByteOrder},
     error::Error,
-    types::{Event, EventId, LogLevel, Packet, PacketContext, PacketHeader, StreamId},
+    types::{
+        counters::AtomicDecodeCounters, stats::StreamStatsTracker, ClockConverter, DecodeCounters,
+        Event, EventId, EventProfile, EventSchema, LogLevel, Packet, PacketContext, PacketHeader,
+        StreamId, StreamStats, Timestamp, TrackingInstant,
+    },
 };
 use bytes::{Buf, BytesMut};
 use fxhash::FxHashMap;
 use internment::Intern;
 use itertools::Itertools;
-use std::io::Read;
+use memchr::memmem::Finder;
+use std::{
+    io::{self, Read},
+    sync::{Mutex, PoisonError},
+    time::Instant,
+};
 use tokio_util::codec::Decoder;
 use tracing::{debug, warn};
 use uuid::Uuid;
 
+/// Per-packet, per-event and per-field tracing in the decode loops, only compiled
+/// in with the `decode-tracing` feature
+macro_rules! decode_trace {
+    ($level:ident, $($arg:tt)+) => {
+        #[cfg(feature = "decode-tracing")]
+        tracing::$level!($($arg)+);
+    };
+}
+
+pub use slice::{PacketFilter, SliceSummary};
+pub use visitor::EventVisitor;
+pub use writer::PacketWriter;
+
+mod parallel;
+mod slice;
 pub(crate) mod types;
+pub(crate) mod visitor;
+mod writer;
 
 /// A barectf CTF byte-stream parser.
 #[derive(Debug)]
@@ -28,9 +55,16 @@ pub struct Parser {
     streams: FxHashMap<StreamId, StreamParser>,
     stream_clocks: FxHashMap<StreamId, Intern<String>>,
     stream_clock_types: FxHashMap<StreamId, Intern<ClockType>>,
+    stream_clock_converters: FxHashMap<StreamId, ClockConverter>,
+    strings: Option<Mutex<StringCache>>,
+    counters: AtomicDecodeCounters,
+    max_packet_size: usize,
 }
 
 impl Parser {
+    /// Default largest packet size accepted, see [`Parser::with_max_packet_size`]
+    pub const DEFAULT_MAX_PACKET_SIZE: usize = 16 * 1024 * 1024;
+
     pub fn new(cfg: &Config) -> Result<Self, Error> {
         // Do some basic semantic checks
         if let Some(magic_ft) = cfg.trace.typ.features.magic_field_type.as_ft() {
@@ -62,6 +96,7 @@ impl Parser {
         let mut streams = FxHashMap::default();
         let mut stream_clocks = FxHashMap::default();
         let mut stream_clock_types = FxHashMap::default();
+        let mut stream_clock_converters = FxHashMap::default();
         for (stream_id, (stream_name, stream)) in cfg
             .trace
             .typ
@@ -75,6 +110,9 @@ impl Parser {
                 if let Some(clock_type) = cfg.trace.typ.clock_types.get(default_clock) {
                     stream_clock_types
                         .insert(stream_id as StreamId, Intern::new(clock_type.clone()));
+                    if let Some(converter) = ClockConverter::new(clock_type) {
+                        stream_clock_converters.insert(stream_id as StreamId, converter);
+                    }
                 }
             }
 
@@ -150,6 +188,15 @@ impl Parser {
                         )
                     })?;
 
+            let stats = StreamStatsTracker::new(
+                sequence_number
+                    .as_ref()
+                    .map_or(u64::MAX, |p| p.desc().size.max_value()),
+                events_discarded
+                    .as_ref()
+                    .map_or(u64::MAX, |p| p.desc().size.max_value()),
+            );
+
             let mut pc_extra_members = Vec::new();
             let pc_extra_member_alignment =
                 stream.packet_context_field_type_extra_members.alignment();
@@ -159,20 +206,19 @@ impl Parser {
                 .iter()
                 .flat_map(|m| m.iter())
             {
-                pc_extra_members.push(EventPayloadMemberParser {
-                    member_name: Intern::new(pc_member_name.clone()),
-                    preferred_display_base: pc_member.field_type.preferred_display_base(),
-                    enum_mappings: EnumerationMappings::from_struct_ft(&pc_member.field_type),
-                    value: FieldTypeParser::from_ft(&pc_member.field_type).map_err(|e| {
-                        Error::unsupported_ft(
-                            format!(
-                                "stream.{}.packet-context-field-type-extra-members.{}",
-                                stream_name, pc_member_name
-                            ),
-                            e,
-                        )
-                    })?,
-                });
+                pc_extra_members.push(
+                    EventPayloadMemberParser::new(pc_member_name, &pc_member.field_type).map_err(
+                        |e| {
+                            Error::unsupported_ft(
+                                format!(
+                                    "stream.{}.packet-context-field-type-extra-members.{}",
+                                    stream_name, pc_member_name
+                                ),
+                                e,
+                            )
+                        },
+                    )?,
+                );
             }
 
             // Event common context
@@ -181,20 +227,19 @@ impl Parser {
             {
                 let mut members = Vec::new();
                 for (member_name, member) in cc_field_type.members.iter().flat_map(|m| m.iter()) {
-                    members.push(EventPayloadMemberParser {
-                        member_name: Intern::new(member_name.clone()),
-                        preferred_display_base: member.field_type.preferred_display_base(),
-                        enum_mappings: EnumerationMappings::from_struct_ft(&member.field_type),
-                        value: FieldTypeParser::from_ft(&member.field_type).map_err(|e| {
-                            Error::unsupported_ft(
-                                format!(
-                                    "stream.{}.event-record-common-context-field-type.{}",
-                                    stream_name, member_name
-                                ),
-                                e,
-                            )
-                        })?,
-                    });
+                    members.push(
+                        EventPayloadMemberParser::new(member_name, &member.field_type).map_err(
+                            |e| {
+                                Error::unsupported_ft(
+                                    format!(
+                                        "stream.{}.event-record-common-context-field-type.{}",
+                                        stream_name, member_name
+                                    ),
+                                    e,
+                                )
+                            },
+                        )?,
+                    );
                 }
 
                 Some(EventPayloadParser {
@@ -225,12 +270,7 @@ impl Parser {
                     let mut members = Vec::new();
                     for (member_name, member) in sc_field_type.members.iter().flat_map(|m| m.iter())
                     {
-                        members.push(EventPayloadMemberParser {
-                            member_name: Intern::new(member_name.clone()),
-                            preferred_display_base: member.field_type.preferred_display_base(),
-                            enum_mappings: EnumerationMappings::from_struct_ft(&member.field_type),
-                            value: FieldTypeParser::from_ft(&member.field_type)
-                                .map_err(|e| {
+                        members.push(EventPayloadMemberParser::new(member_name, &member.field_type).map_err(|e| {
                                 Error::unsupported_ft(
                                     format!(
                                         "stream.{}.event-record-types.{}.specific-context-field-type.{}",
@@ -240,8 +280,7 @@ impl Parser {
                                     ),
                                     e,
                                 )
-                            })?,
-                        });
+                            })?);
                     }
 
                     Some(EventPayloadParser {
@@ -262,20 +301,18 @@ impl Parser {
                     for (member_name, member) in
                         payload_field_type.members.iter().flat_map(|m| m.iter())
                     {
-                        members.push(EventPayloadMemberParser {
-                            member_name: Intern::new(member_name.clone()),
-                            preferred_display_base: member.field_type.preferred_display_base(),
-                            enum_mappings: EnumerationMappings::from_struct_ft(&member.field_type),
-                            value: FieldTypeParser::from_ft(&member.field_type).map_err(|e| {
-                                Error::unsupported_ft(
-                                    format!(
-                                        "stream.{}.event-record-types.{}.payload-field-type.{}",
-                                        stream_name, event_name, member_name
-                                    ),
-                                    e,
-                                )
-                            })?,
-                        });
+                        members.push(
+                            EventPayloadMemberParser::new(member_name, &member.field_type)
+                                .map_err(|e| {
+                                    Error::unsupported_ft(
+                                        format!(
+                                            "stream.{}.event-record-types.{}.payload-field-type.{}",
+                                            stream_name, event_name, member_name
+                                        ),
+                                        e,
+                                    )
+                                })?,
+                        );
                     }
 
                     Some(EventPayloadParser {
@@ -293,13 +330,35 @@ impl Parser {
                     None
                 };
 
+                let schemas = |p: Option<&EventPayloadParser>| {
+                    p.map(EventPayloadParser::schemas).unwrap_or_default()
+                };
+                let schema = Intern::new(EventSchema::new(
+                    event_id as EventId,
+                    event_name,
+                    event.log_level.map(LogLevel::from),
+                    &schemas(common_context.as_ref()),
+                    &schemas(specific_context.as_ref()),
+                    &schemas(payload.as_ref()),
+                ));
+
+                let max_wire_size = [
+                    common_context.as_ref(),
+                    specific_context.as_ref(),
+                    payload.as_ref(),
+                ]
+                .into_iter()
+                .flatten()
+                .try_fold(0_usize, |size, p| size.checked_add(p.max_wire_size()?));
+
                 events.insert(
                     event_id as EventId,
                     EventParser {
-                        event_name: Intern::new(event_name.clone()),
-                        log_level: event.log_level,
+                        schema,
                         specific_context,
                         payload,
+                        max_wire_size,
+                        profile: Default::default(),
                     },
                 );
             }
@@ -368,6 +427,20 @@ impl Parser {
                     },
                     common_context,
                     events,
+                    clock: TrackingInstant::new(&stream.features.event_record.timestamp_field_type)
+                        .map_err(|_| {
+                            let ft = &stream.features.event_record.timestamp_field_type;
+                            Error::UnsupportedFieldType(
+                                format!(
+                                    "stream.{}.$features.event-record.timestamp-field-type",
+                                    stream_name
+                                ),
+                                ft.field_type.size,
+                                ft.field_type.alignment,
+                            )
+                        })?,
+                    stats: Mutex::new(stats),
+                    profiling: false,
                 },
             );
         }
@@ -379,18 +452,150 @@ impl Parser {
             streams,
             stream_clocks,
             stream_clock_types,
+            stream_clock_converters,
+            strings: None,
+            counters: AtomicDecodeCounters::default(),
+            max_packet_size: Self::DEFAULT_MAX_PACKET_SIZE,
         })
     }
 
+    /// Share repeated string field values through a per-parser dedup cache
+    /// holding up to `capacity` distinct strings.
+    ///
+    /// Decoded [`PrimitiveFieldValue::String`](crate::types::PrimitiveFieldValue::String)
+    /// values with the same bytes then point to the same allocation.
+    pub fn with_string_cache(mut self, capacity: usize) -> Self {
+        self.strings = Some(Mutex::new(StringCache::new(capacity)));
+        self
+    }
+
+    /// Set the largest packet size (bytes) accepted.
+    ///
+    /// Packets are buffered whole before their events are decoded, so larger
+    /// sizes are rejected as [`Error::InvalidPacketSize`] up front rather than
+    /// allocated, or buffered until the end of the input, e.g. for a corrupt size field.
+    pub fn with_max_packet_size(mut self, bytes: usize) -> Self {
+        self.max_packet_size = bytes;
+        self
+    }
+
+    /// The packet must be a whole number of bytes holding its preamble
+    /// (`preamble_bytes`) and content, and no larger than the max packet size.
+    /// Checked by every decoding path right after the packet context.
+    fn check_packet_size(
+        &self,
+        context: &PacketContext,
+        preamble_bytes: usize,
+    ) -> Result<(), Error> {
+        if context.packet_size() > self.max_packet_size
+            || context.packet_size_bits & 0x7 != 0
+            || context.packet_size() < preamble_bytes
+            || context.content_size_bits > context.packet_size_bits
+            || context.content_size_bits < preamble_bytes * 8
+        {
+            return Err(Error::InvalidPacketSize(
+                context.packet_size_bits,
+                context.content_size_bits,
+            ));
+        }
+        Ok(())
+    }
+
+    /// Snapshot of a stream's packet accounting, covering the packets decoded
+    /// so far by [`Parser::parse`], [`Parser::visit`] and the [`PacketDecoder`].
+    ///
+    /// The packets are taken to come from a single input, in stream order: decoding
+    /// several inputs with the same parser mixes up their sequence numbers and
+    /// discarded event counters. Use a parser per input to account for them
+    /// separately, a [`PacketDecoder`] owns its own.
+    pub fn stream_stats(&self, stream_id: StreamId) -> Option<StreamStats> {
+        self.streams.get(&stream_id).map(|s| {
+            s.stats
+                .lock()
+                .unwrap_or_else(PoisonError::into_inner)
+                .stats()
+        })
+    }
+
+    /// Time and size the decoding of every event, per stream and event record type,
+    /// see [`Parser::profile`].
+    ///
+    /// Costs a clock read per event.
+    pub fn with_profiling(mut self) -> Self {
+        for stream in self.streams.values_mut() {
+            stream.profiling = true;
+        }
+        self
+    }
+
+    /// Decode cost of every event record type so far, ordered by stream ID then event ID.
+    /// Empty unless [`Parser::with_profiling`] is enabled.
+    ///
+    /// Covers [`Parser::parse`], the [`PacketDecoder`] and [`Parser::parse_parallel`].
+    /// For [`Parser::visit`], the time spent in the visitor's callbacks is included.
+    pub fn profile(&self) -> Vec<EventProfile> {
+        self.streams
+            .iter()
+            .filter(|(_, s)| s.profiling)
+            .flat_map(|(stream_id, s)| {
+                s.events
+                    .values()
+                    .map(|e| e.profile.snapshot(*stream_id, e.schema))
+            })
+            .sorted_by_key(|p| (p.stream_id, p.schema.id()))
+            .collect()
+    }
+
+    /// Snapshot of the packet, event and byte totals decoded so far
+    pub fn counters(&self) -> DecodeCounters {
+        self.counters.snapshot()
+    }
+
+    /// The event schemas of every stream, ordered by stream ID then event ID
+    pub fn event_schemas(&self) -> Vec<(StreamId, Intern<EventSchema>)> {
+        self.streams
+            .iter()
+            .flat_map(|(stream_id, s)| s.events.values().map(|e| (*stream_id, e.schema)))
+            .sorted_by_key(|(stream_id, schema)| (*stream_id, schema.id()))
+            .collect()
+    }
+
+    /// Cycles to nanoseconds converter of a stream's default clock, if it has one
+    pub fn clock_converter(&self, stream_id: StreamId) -> Option<&ClockConverter> {
+        self.stream_clock_converters.get(&stream_id)
+    }
+
     pub fn into_packet_decoder(self) -> PacketDecoder {
         PacketDecoder {
             parser: self,
+            clocks: StreamClocks::default(),
             state: PacketDecoderState::Header,
+            resync: None,
         }
     }
 
+    /// Parse a packet.
+    ///
+    /// Packets are decoded on their own: event timestamps narrower than 64 bits are
+    /// seeded from the packet beginning timestamp, or start from zero when the stream
+    /// doesn't have one. Use a [`PacketDecoder`] to carry them over from packet to packet.
+    ///
+    /// Returns an [`io::ErrorKind::UnexpectedEof`] error at the end of the input. It's
+    /// only counted in [`Parser::counters`] when the input ends mid-packet.
     pub fn parse<R: Read>(&self, r: &mut R) -> Result<Packet, Error> {
-        let mut r = StreamReader::new(self.byte_order, r);
+        self.counters
+            .count(self.parse_packet(r))?
+            .ok_or_else(end_of_input)
+    }
+
+    /// `None` at the end of `r`, which isn't counted as an error
+    fn parse_packet<R: Read>(&self, r: &mut R) -> Result<Option<Packet>, Error> {
+        let mut first = [0_u8];
+        if read_fully(r, &mut first)? == 0 {
+            return Ok(None);
+        }
+        let mut r = Read::chain(first.as_slice(), r);
+        let mut r = StreamReader::new(self.byte_order, &mut r);
 
         let header = self.parse_header(&mut r)?;
 
@@ -401,17 +606,179 @@ impl Parser {
             .ok_or(Error::UndefinedStreamId(header.stream_id))?;
 
         let context = Self::parse_packet_context(stream, &mut r)?;
+        self.check_packet_size(&context, r.cursor.cursor_bytes())?;
+
+        // Events are decoded from the rest of the packet, read in one go
+        let (cursor, buf) = Self::read_packet_remainder(&context, r)?;
 
-        let events = Self::parse_events(stream, &context, &mut r)?;
+        // Held for the events rather than per string field, not across the IO above
+        let mut strings = self
+            .strings
+            .as_ref()
+            .map(|s| s.lock().unwrap_or_else(PoisonError::into_inner));
+        let mut r = StreamReader::new_with_cursor(self.byte_order, cursor, buf.as_slice())
+            .with_string_cache(strings.as_deref_mut());
 
-        Ok(Packet {
+        let mut clock = stream.packet_clock(&context);
+        let events = Self::parse_events(stream, &context, &mut clock, &mut r)?;
+        stream.record_packet(&context);
+        self.counters.record_packet(&context, events.len());
+
+        Ok(Some(Packet {
             header,
             context,
             events,
+        }))
+    }
+
+    /// Parse a packet, handing its contents to `visitor` as they're decoded
+    /// instead of building a [`Packet`]. Event timestamps are as in [`Parser::parse`].
+    pub fn visit<R: Read, V: EventVisitor + ?Sized>(
+        &self,
+        r: &mut R,
+        visitor: &mut V,
+    ) -> Result<(), Error> {
+        self.counters
+            .count(self.visit_packet(r, visitor))?
+            .ok_or_else(end_of_input)
+    }
+
+    /// `None` at the end of `r`, see [`Parser::parse_packet`]
+    fn visit_packet<R: Read, V: EventVisitor + ?Sized>(
+        &self,
+        r: &mut R,
+        visitor: &mut V,
+    ) -> Result<Option<()>, Error> {
+        let mut first = [0_u8];
+        if read_fully(r, &mut first)? == 0 {
+            return Ok(None);
+        }
+        let mut r = Read::chain(first.as_slice(), r);
+        let mut r = StreamReader::new(self.byte_order, &mut r);
+
+        let header = self.parse_header(&mut r)?;
+        visitor.on_packet_header(&header);
+
+        // Stream-specific from here on
+        let stream = self
+            .streams
+            .get(&header.stream_id)
+            .ok_or(Error::UndefinedStreamId(header.stream_id))?;
+
+        let context = Self::parse_packet_context(stream, &mut r)?;
+        self.check_packet_size(&context, r.cursor.cursor_bytes())?;
+        visitor.on_packet_context(&context);
+
+        let (cursor, buf) = Self::read_packet_remainder(&context, r)?;
+        let mut r = StreamReader::new_with_cursor(self.byte_order, cursor, buf.as_slice());
+
+        let events = Self::visit_events(stream, &context, &mut r, visitor)?;
+        stream.record_packet(&context);
+        self.counters.record_packet(&context, events);
+        visitor.on_packet_end();
+        Ok(Some(()))
+    }
+
+    /// Read the rest of the packet following its context
+    fn read_packet_remainder<R: Read>(
+        context: &PacketContext,
+        mut r: StreamReader<&mut R>,
+    ) -> Result<(AlignedCursor, Vec<u8>), Error> {
+        // Checked against the max packet size beforehand
+        let mut buf = vec![0_u8; context.packet_size() - r.cursor.cursor_bytes()];
+        r.inner.inner_mut().read_exact(&mut buf)?;
+        Ok((r.into_cursor(), buf))
+    }
+
+    /// Parse the header of the next event, returning its parser and
+    /// full (rollover-tracked) timestamp
+    fn parse_event_header<'p, R: ByteSource>(
+        stream: &'p StreamParser,
+        clock: &mut TrackingInstant,
+        r: &mut StreamReader<R>,
+    ) -> Result<(&'p EventParser, Timestamp), Error> {
+        // Align for header structure
+        r.align_to(stream.event_header.alignment)?;
+
+        // Parse event header structure
+        let event_id = stream.event_header.event_id.parse(r)?;
+        let timestamp = stream.event_header.timestamp.parse(r)?;
+        decode_trace!(debug, event_id, timestamp, "Parsed event header");
+
+        let event = stream
+            .events
+            .get(&event_id)
+            .ok_or(Error::UndefinedEventId(event_id))?;
+        Ok((event, clock.elapsed(timestamp)))
+    }
+
+    /// Parse the header and context of a packet held in `packet`.
+    /// Also returns the byte offset of the packet's first event, for decoding
+    /// the events separately, e.g. with the [`codegen`](crate::codegen) decoders.
+    pub fn parse_packet_preamble(
+        &self,
+        packet: &[u8],
+    ) -> Result<(PacketHeader, PacketContext, usize), Error> {
+        let mut r = StreamReader::new(self.byte_order, packet);
+        let header = self.parse_header(&mut r)?;
+        let stream = self
+            .streams
+            .get(&header.stream_id)
+            .ok_or(Error::UndefinedStreamId(header.stream_id))?;
+        let context = Self::parse_packet_context(stream, &mut r)?;
+        self.check_packet_size(&context, r.cursor.cursor_bytes())?;
+        Ok((header, context, r.cursor.cursor_bytes()))
+    }
+
+    /// The packet header magic number as laid out in the stream, if the header has one
+    fn magic_bytes(&self) -> Option<[u8; 4]> {
+        self.pkt_header.magic.as_ref()?;
+        Some(match self.byte_order {
+            NativeByteOrder::LittleEndian => PacketHeader::MAGIC.to_le_bytes(),
+            NativeByteOrder::BigEndian => PacketHeader::MAGIC.to_be_bytes(),
         })
     }
 
-    fn parse_header<R: Read>(&self, r: &mut StreamReader<R>) -> Result<PacketHeader, Error> {
+    /// Parse and validate the header and context of the packet at the start of `src`,
+    /// see [`Parser::validate_preamble`]
+    fn parse_checked_preamble<'p>(
+        &'p self,
+        src: &[u8],
+    ) -> Result<(PacketHeader, &'p StreamParser, PacketContext, AlignedCursor), Error> {
+        let mut r = StreamReader::new(self.byte_order, src);
+        let header = self.parse_header(&mut r)?;
+        let stream = self
+            .streams
+            .get(&header.stream_id)
+            .ok_or(Error::UndefinedStreamId(header.stream_id))?;
+        let context = Self::parse_packet_context(stream, &mut r)?;
+        let cursor = r.into_cursor();
+        self.validate_preamble(&header, &context, cursor.cursor_bytes())?;
+        Ok((header, stream, context, cursor))
+    }
+
+    /// The magic number and trace UUID checks, on top of [`Parser::check_packet_size`],
+    /// for telling a real packet from a corrupt one
+    fn validate_preamble(
+        &self,
+        header: &PacketHeader,
+        context: &PacketContext,
+        preamble_bytes: usize,
+    ) -> Result<(), Error> {
+        if let Some(m) = header.magic_number {
+            if m != PacketHeader::MAGIC {
+                return Err(Error::InvalidMagicNumber(m));
+            }
+        }
+        if let (Some(uuid), Some(schema_uuid)) = (header.trace_uuid, self.trace_uuid) {
+            if uuid != schema_uuid {
+                return Err(Error::TraceUuidMismatch(uuid));
+            }
+        }
+        self.check_packet_size(context, preamble_bytes)
+    }
+
+    fn parse_header<R: ByteSource>(&self, r: &mut StreamReader<R>) -> Result<PacketHeader, Error> {
         // Align for packet header structure
         r.align_to(self.pkt_header.alignment)?;
 
@@ -430,7 +797,13 @@ impl Parser {
             .map(|p| p.parse(r))
             .transpose()?;
         let stream_id = self.pkt_header.stream_id.parse(r)?;
-        debug!(stream_id, ?magic, ?trace_uuid, "Parsed packet header");
+        decode_trace!(
+            debug,
+            stream_id,
+            ?magic,
+            ?trace_uuid,
+            "Parsed packet header"
+        );
         if let Some(m) = magic {
             if m != PacketHeader::MAGIC {
                 warn!(
@@ -469,7 +842,7 @@ impl Parser {
         })
     }
 
-    fn parse_packet_context<R: Read>(
+    fn parse_packet_context<R: ByteSource>(
         stream: &StreamParser,
         r: &mut StreamReader<R>,
     ) -> Result<PacketContext, Error> {
@@ -508,10 +881,11 @@ impl Parser {
         let mut extra_members = Vec::new();
         for member in stream.packet_context.extra_members.iter() {
             let val = member.parse(r)?;
-            extra_members.push((member.member_name, val));
+            extra_members.push((member.schema, val));
         }
 
-        debug!(
+        decode_trace!(
+            debug,
             packet_size = pkt_size_bits,
             content_size = content_size_bits,
             ?events_discarded,
@@ -535,105 +909,269 @@ impl Parser {
         })
     }
 
-    fn parse_events<R: Read>(
+    /// Parse the events of a packet, see [`StreamClocks::packet_clock`] for the `clock`.
+    /// The residual bits between the packet content and the end of the packet
+    /// are left to the caller, which already holds the packet buffer.
+    fn parse_events<R: ByteSource>(
         stream: &StreamParser,
         packet_context: &PacketContext,
+        clock: &mut TrackingInstant,
         r: &mut StreamReader<R>,
     ) -> Result<Vec<Event>, Error> {
         let mut events = Vec::new();
 
         // Read until we reach the end of the actual packet content
-        loop {
-            // Align for header structure
-            r.align_to(stream.event_header.alignment)?;
-
-            // Parse event header structure
-            let event_id = stream.event_header.event_id.parse(r)?;
-            let timestamp = stream.event_header.timestamp.parse(r)?;
-            debug!(event_id, timestamp, "Parsed event header");
-
-            // Align for common context structure
-            // Common context
-            let mut common_context = Vec::new();
-            if let Some(p) = stream.common_context.as_ref() {
-                // Align for common context structure
-                r.align_to(p.alignment)?;
+        while r.cursor_bits() < packet_context.content_size_bits {
+            let start = stream.profiling.then(|| (Instant::now(), r.cursor_bits()));
+            let (event, timestamp) = Self::parse_event_header(stream, clock, r)?;
+            let mut values = Vec::with_capacity(event.schema.len());
 
-                // Align for and read each member
-                for member in p.members.iter() {
-                    let val = member.parse(r)?;
-                    common_context.push((member.member_name, val));
-                }
-            }
-
-            // Event-specific from here on
-            let event = stream
-                .events
-                .get(&event_id)
-                .ok_or(Error::UndefinedEventId(event_id))?;
-
-            // Specific context
-            let mut specific_context = Vec::new();
-            if let Some(p) = event.specific_context.as_ref() {
-                // Align for specific context structure
-                r.align_to(p.alignment)?;
-
-                // Align for and read each member
-                for member in p.members.iter() {
-                    let val = member.parse(r)?;
-                    specific_context.push((member.member_name, val));
-                }
-            }
+            // Common context, specific context then payload
+            let sections = [
+                stream.common_context.as_ref(),
+                event.specific_context.as_ref(),
+                event.payload.as_ref(),
+            ];
 
-            // Payload
-            let mut payload = Vec::new();
-            if let Some(p) = event.payload.as_ref() {
-                // Align for payload structure
-                r.align_to(p.alignment)?;
+            // Fixed-size events are bounds-checked once, up front
+            let bounded = event.max_wire_size.and_then(|size| {
+                r.read_bounded(size, |b| {
+                    for p in sections.into_iter().flatten() {
+                        b.align_to(p.alignment);
+                        for member in p.members.iter() {
+                            values.push(member.parse_bounded(b));
+                        }
+                    }
+                })
+            });
+            if bounded.is_none() {
+                for p in sections.into_iter().flatten() {
+                    // Align for the structure
+                    r.align_to(p.alignment)?;
 
-                // Align for and read each member
-                for member in p.members.iter() {
-                    let val = member.parse(r)?;
-                    payload.push((member.member_name, val));
+                    // Align for and read each member
+                    for member in p.members.iter() {
+                        values.push(member.parse(r)?);
+                    }
                 }
             }
 
             events.push(Event {
-                id: event_id,
-                name: event.event_name,
+                schema: event.schema,
                 timestamp,
-                log_level: event.log_level.map(LogLevel::from),
-                specific_context,
-                common_context,
-                payload,
+                values,
             });
 
-            // Done with actual packet data, may still be residual bits to skip over
-            debug_assert!(r.cursor_bits() <= packet_context.content_size_bits);
-            if r.cursor_bits() == packet_context.content_size_bits {
-                break;
+            if let Some((t, start_bits)) = start {
+                event
+                    .profile
+                    .record(t.elapsed(), r.cursor_bits() - start_bits);
             }
         }
 
-        // Skip the remaining in the packet
-        let remaining_bits = packet_context.packet_size_bits - packet_context.content_size_bits;
-        if remaining_bits != 0 {
-            let remaining_bytes = remaining_bits >> 3;
-            for _ in 0..remaining_bytes {
-                // No need to maintain alignment/etc, we're done with the reader
-                r.inner.read_u8()?;
+        Self::check_content_size(packet_context, r.cursor_bits())?;
+        Ok(events)
+    }
+
+    /// Visit the events of a packet, see [`Parser::parse_events`]
+    fn visit_events<R: ByteSource, V: EventVisitor + ?Sized>(
+        stream: &StreamParser,
+        packet_context: &PacketContext,
+        r: &mut StreamReader<R>,
+        visitor: &mut V,
+    ) -> Result<usize, Error> {
+        // Not shared, the visitor runs with no lock held
+        let mut clock = stream.packet_clock(packet_context);
+        let mut events = 0;
+
+        // Read until we reach the end of the actual packet content
+        while r.cursor_bits() < packet_context.content_size_bits {
+            let start_bits = r.cursor_bits();
+            let start = stream.profiling.then(Instant::now);
+            let (event, timestamp) = Self::parse_event_header(stream, &mut clock, r)?;
+            visitor.on_event_begin(&event.schema, timestamp);
+
+            for p in [
+                stream.common_context.as_ref(),
+                event.specific_context.as_ref(),
+                event.payload.as_ref(),
+            ]
+            .into_iter()
+            .flatten()
+            {
+                // Align for the structure
+                r.align_to(p.alignment)?;
+
+                // Align for and visit each member
+                for member in p.members.iter() {
+                    member.visit(r, visitor)?;
+                }
             }
+
+            visitor.on_event_end();
+            visitor.on_event_size(r.cursor_bits() - start_bits);
+            if let Some(t) = start {
+                event
+                    .profile
+                    .record(t.elapsed(), r.cursor_bits() - start_bits);
+            }
+            events += 1;
         }
 
+        Self::check_content_size(packet_context, r.cursor_bits())?;
         Ok(events)
     }
+
+    /// The last event must end within the packet content
+    fn check_content_size(packet_context: &PacketContext, cursor_bits: usize) -> Result<(), Error> {
+        if cursor_bits > packet_context.content_size_bits {
+            return Err(Error::InvalidPacketSize(
+                packet_context.packet_size_bits,
+                packet_context.content_size_bits,
+            ));
+        }
+        Ok(())
+    }
+}
+
+/// The error for [`Parser::parse`] and [`Parser::visit`] at the end of the input
+fn end_of_input() -> Error {
+    io::Error::from(io::ErrorKind::UnexpectedEof).into()
 }
 
 /// A barectf CTF byte-stream decoder.
 #[derive(Debug)]
 pub struct PacketDecoder {
     parser: Parser,
+    /// Timestamps carried over between the packets of the input
+    clocks: StreamClocks,
     state: PacketDecoderState,
+    /// Magic number searcher, in resync mode
+    resync: Option<Finder<'static>>,
+}
+
+impl PacketDecoder {
+    pub fn parser(&self) -> &Parser {
+        &self.parser
+    }
+
+    /// Recover from corrupt or torn packets rather than ending the stream with an error.
+    ///
+    /// When a packet fails to decode, or its header and context don't hold up
+    /// (wrong magic number or trace UUID, inconsistent sizes), the decoder
+    /// scans forward for the next magic number and resumes there.
+    /// Packets are only consumed once fully decoded, so a torn packet costs
+    /// the bytes up to the next good one, see [`PacketDecoder::skipped_bytes`].
+    ///
+    /// Requires the trace type's magic field type, decoding errors are returned
+    /// as usual without it.
+    pub fn with_resync(mut self) -> Self {
+        self.resync = self
+            .parser
+            .magic_bytes()
+            .map(|magic| Finder::new(&magic).into_owned());
+        self
+    }
+
+    /// Set the largest packet size (bytes) accepted, see [`Parser::with_max_packet_size`].
+    /// In resync mode, the decoder skips to the next magic number past larger packets.
+    pub fn with_max_packet_size(mut self, bytes: usize) -> Self {
+        self.parser.max_packet_size = bytes;
+        self
+    }
+
+    /// Number of bytes dropped while resynchronizing, see [`PacketDecoder::with_resync`]
+    pub fn skipped_bytes(&self) -> u64 {
+        self.parser.counters.skipped_bytes()
+    }
+
+    /// Snapshot of the decoder's totals, see [`Parser::counters`]
+    pub fn counters(&self) -> DecodeCounters {
+        self.parser.counters()
+    }
+
+    fn decode_resync(&mut self, src: &mut BytesMut, eof: bool) -> Result<Option<Packet>, Error> {
+        loop {
+            if src.is_empty() {
+                return Ok(None);
+            }
+            match self.decode_packet_at_start(src) {
+                Ok(Some((pkt, size))) => {
+                    src.advance(size);
+                    return Ok(Some(pkt));
+                }
+                Ok(None) if !eof => return Ok(None),
+                Ok(None) => {
+                    warn!(len = src.len(), "Truncated packet at end of stream");
+                    self.parser
+                        .counters
+                        .record_error(&io::Error::from(io::ErrorKind::UnexpectedEof).into());
+                    self.skip_to_next_magic(src);
+                }
+                Err(e) => {
+                    warn!("Resynchronizing after corrupt packet: {e}");
+                    self.parser.counters.record_error(&e);
+                    self.skip_to_next_magic(src);
+                }
+            }
+        }
+    }
+
+    /// Decode the packet at the start of `src`, returning it along with its size in bytes.
+    /// Returns `None` when more data is needed.
+    fn decode_packet_at_start(&mut self, src: &[u8]) -> Result<Option<(Packet, usize)>, Error> {
+        let (header, _, context, cursor) = match self.parser.parse_checked_preamble(src) {
+            Ok(p) => p,
+            Err(Error::Io(e)) if e.kind() == io::ErrorKind::UnexpectedEof => return Ok(None),
+            Err(e) => return Err(e),
+        };
+
+        let packet_size = context.packet_size();
+        if src.len() < packet_size {
+            return Ok(None);
+        }
+
+        // SAFETY: the stream ID was checked along with the preamble
+        let stream = self.parser.streams.get(&header.stream_id).unwrap();
+        let strings = self
+            .parser
+            .strings
+            .as_mut()
+            .map(|s| s.get_mut().unwrap_or_else(PoisonError::into_inner));
+        let mut r = StreamReader::new_with_cursor(
+            self.parser.byte_order,
+            cursor,
+            &src[cursor.cursor_bytes()..packet_size],
+        )
+        .with_string_cache(strings);
+        let clock = self.clocks.packet_clock(header.stream_id, stream, &context);
+        let events = Parser::parse_events(stream, &context, clock, &mut r)?;
+        stream.record_packet(&context);
+        self.parser.counters.record_packet(&context, events.len());
+
+        Ok(Some((
+            Packet {
+                header,
+                context,
+                events,
+            },
+            packet_size,
+        )))
+    }
+
+    /// Drop at least one byte, up to the next magic number candidate.
+    /// A possibly partial magic number at the end of `src` is kept.
+    fn skip_to_next_magic(&mut self, src: &mut BytesMut) {
+        // SAFETY: only called in resync mode
+        let finder = self.resync.as_ref().unwrap();
+        let skip = finder
+            .find(&src[1..])
+            .map(|pos| pos + 1)
+            .unwrap_or_else(|| src.len().saturating_sub(finder.needle().len() - 1).max(1));
+        src.advance(skip);
+        self.parser.counters.record_skipped(skip);
+        debug!(skip, "Skipped to next magic number candidate");
+    }
 }
 
 #[derive(Debug)]
@@ -648,6 +1186,32 @@ impl Decoder for PacketDecoder {
     type Error = Error;
 
     fn decode(&mut self, src: &mut BytesMut) -> Result<Option<Self::Item>, Self::Error> {
+        if self.resync.is_some() {
+            return self.decode_resync(src, false);
+        }
+        let res = self.decode_framed(src);
+        self.parser.counters.count(res)
+    }
+
+    fn decode_eof(&mut self, src: &mut BytesMut) -> Result<Option<Self::Item>, Self::Error> {
+        if self.resync.is_some() {
+            return self.decode_resync(src, true);
+        }
+
+        match self.decode(src)? {
+            Some(pkt) => Ok(Some(pkt)),
+            None if src.is_empty() => Ok(None),
+            None => self
+                .parser
+                .counters
+                .count(Err(io::Error::other("bytes remaining on stream").into())),
+        }
+    }
+}
+
+impl PacketDecoder {
+    /// Decode without resynchronizing, see [`Decoder::decode`]
+    fn decode_framed(&mut self, src: &mut BytesMut) -> Result<Option<Packet>, Error> {
         // Loop until we've got a full packet or need more data
         loop {
             match std::mem::replace(&mut self.state, PacketDecoderState::Header) {
@@ -682,14 +1246,22 @@ impl Decoder for PacketDecoder {
                     }
 
                     let mut src_reader = src.reader();
+                    let strings = self
+                        .parser
+                        .strings
+                        .as_mut()
+                        .map(|s| s.get_mut().unwrap_or_else(PoisonError::into_inner));
                     let mut r = StreamReader::new_with_cursor(
                         self.parser.byte_order,
                         cursor,
                         &mut src_reader,
-                    );
+                    )
+                    .with_string_cache(strings);
 
                     let packet_context = Parser::parse_packet_context(stream, &mut r)?;
                     let cursor = r.into_cursor();
+                    self.parser
+                        .check_packet_size(&packet_context, cursor.cursor_bytes())?;
 
                     self.state = PacketDecoderState::Events(header, packet_context, cursor);
                 }
@@ -707,14 +1279,28 @@ impl Decoder for PacketDecoder {
                         .get(&header.stream_id)
                         .ok_or(Error::UndefinedStreamId(header.stream_id))?;
 
-                    let mut src_reader = src.reader();
+                    // Decode straight from the packet buffer, then drop the
+                    // whole packet, including any residual padding
+                    let strings = self
+                        .parser
+                        .strings
+                        .as_mut()
+                        .map(|s| s.get_mut().unwrap_or_else(PoisonError::into_inner));
                     let mut r = StreamReader::new_with_cursor(
                         self.parser.byte_order,
                         cursor,
-                        &mut src_reader,
-                    );
-
-                    let events = Parser::parse_events(stream, &packet_context, &mut r)?;
+                        &src[..remaining_bytes],
+                    )
+                    .with_string_cache(strings);
+                    let clock = self
+                        .clocks
+                        .packet_clock(header.stream_id, stream, &packet_context);
+                    let events = Parser::parse_events(stream, &packet_context, clock, &mut r)?;
+                    stream.record_packet(&packet_context);
+                    self.parser
+                        .counters
+                        .record_packet(&packet_context, events.len());
+                    src.advance(remaining_bytes);
 
                     let pkt = Packet {
                         header,
@@ -0,0 +1,134 @@
+use super::{
+    types::{StreamClocks, StreamReader},
+    Parser,
+};
+use crate::{error::Error, types::Packet};
+use memchr::memmem;
+use std::{io, panic, thread};
+use tracing::debug;
+
+/// Number of packets, following a magic number candidate, whose header and
+/// context must also check out for it to be taken as a packet boundary
+const BOUNDARY_CONFIRMATIONS: usize = 2;
+
+impl Parser {
+    /// Split a stream held in memory into up to `ranges` byte ranges starting on
+    /// packet boundaries, returning the start offset of each range.
+    ///
+    /// Each range starts at the first magic number at or after an even split of
+    /// `data` that's confirmed by chaining the packet sizes of the packets
+    /// following it.
+    /// The first range always starts at offset 0. Without the trace type's
+    /// magic field type, there's only that one.
+    pub fn chunk_boundaries(&self, data: &[u8], ranges: usize) -> Vec<usize> {
+        let mut boundaries = vec![0];
+        let Some(magic) = self.magic_bytes() else {
+            return boundaries;
+        };
+        let finder = memmem::Finder::new(&magic);
+
+        for i in 1..ranges {
+            let mut pos = (data.len() / ranges) * i;
+            // Skip ahead of the previous boundary
+            pos = pos.max(boundaries.last().copied().unwrap_or_default() + 1);
+            while let Some(offset) = data.get(pos..).and_then(|d| finder.find(d)) {
+                let candidate = pos + offset;
+                if self.is_packet_boundary(data, candidate) {
+                    boundaries.push(candidate);
+                    break;
+                }
+                pos = candidate + 1;
+            }
+        }
+
+        debug!(?boundaries, "Found chunk boundaries");
+        boundaries
+    }
+
+    /// Parse a stream held in memory, decoding the ranges found by
+    /// [`Parser::chunk_boundaries`] on a thread each.
+    /// Returns the packets in stream order, or the first error.
+    ///
+    /// Event timestamp rollover tracking restarts at each range, so full timestamps
+    /// rely on the streams' packet beginning timestamps when their timestamp
+    /// field types are narrower than 64 bits.
+    /// Packets are checked like [`PacketDecoder::with_resync`](crate::PacketDecoder::with_resync)
+    /// does. The string cache isn't used, and [`Parser::stream_stats`] isn't updated.
+    /// [`Parser::counters`] are.
+    pub fn parse_parallel(&self, data: &[u8], ranges: usize) -> Result<Vec<Packet>, Error> {
+        let boundaries = self.chunk_boundaries(data, ranges);
+        let ends = boundaries.iter().skip(1).copied().chain([data.len()]);
+
+        let chunks = thread::scope(|s| {
+            let handles: Vec<_> = boundaries
+                .iter()
+                .zip(ends)
+                .map(|(&start, end)| {
+                    s.spawn(move || self.counters.count(self.parse_range(data, start, end)))
+                })
+                .collect();
+            handles
+                .into_iter()
+                .map(|h| h.join().unwrap_or_else(|e| panic::resume_unwind(e)))
+                .collect::<Result<Vec<_>, Error>>()
+        })?;
+
+        Ok(chunks.into_iter().flatten().collect())
+    }
+
+    /// True if a packet starts at `pos`, followed by [`BOUNDARY_CONFIRMATIONS`]
+    /// packets or the end of `data`
+    fn is_packet_boundary(&self, data: &[u8], mut pos: usize) -> bool {
+        for _ in 0..=BOUNDARY_CONFIRMATIONS {
+            if pos == data.len() {
+                return true;
+            }
+            match self.parse_checked_preamble(&data[pos..]) {
+                Ok((_, _, context, _)) => pos += context.packet_size(),
+                Err(_) => return false,
+            }
+            if pos > data.len() {
+                return false;
+            }
+        }
+        true
+    }
+
+    /// Parse the packets starting within `data[start..end]`
+    fn parse_range(&self, data: &[u8], start: usize, end: usize) -> Result<Vec<Packet>, Error> {
+        let mut packets = Vec::new();
+        // Range-local, carried over between the range's packets
+        let mut clocks = StreamClocks::default();
+        let mut pos = start;
+        while pos < end {
+            let src = &data[pos..];
+            let (header, stream, context, cursor) = self.parse_checked_preamble(src)?;
+            let packet_size = context.packet_size();
+            let packet = src
+                .get(cursor.cursor_bytes()..packet_size)
+                .ok_or_else(|| io::Error::from(io::ErrorKind::UnexpectedEof))?;
+
+            // The packets must chain up to the next range's start, a range that
+            // doesn't was split on a false boundary
+            if pos + packet_size > end {
+                return Err(Error::InvalidPacketSize(
+                    context.packet_size_bits,
+                    context.content_size_bits,
+                ));
+            }
+
+            let clock = clocks.packet_clock(header.stream_id, stream, &context);
+
+            let mut r = StreamReader::new_with_cursor(self.byte_order, cursor, packet);
+            let events = Self::parse_events(stream, &context, clock, &mut r)?;
+            self.counters.record_packet(&context, events.len());
+            packets.push(Packet {
+                header,
+                context,
+                events,
+            });
+            pos += packet_size;
+        }
+        Ok(packets)
+    }
+}
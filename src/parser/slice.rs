@@ -0,0 +1,153 @@
+use super::{types::StreamReader, Parser};
+use crate::{
+    error::Error,
+    types::{PacketContext, PacketHeader, SequenceNumber, StreamId, Timestamp},
+};
+use std::{
+    io::{self, Read, Write},
+    ops::RangeInclusive,
+};
+
+/// Packet selection criteria for [`Parser::slice`].
+///
+/// A packet is selected when it matches every criterion that's set.
+/// Criteria on packet context fields a stream doesn't have are ignored
+/// for that stream's packets.
+#[derive(Clone, Debug, Default, PartialEq, Eq)]
+pub struct PacketFilter {
+    /// Streams to keep
+    pub streams: Option<Vec<StreamId>>,
+    /// Packet sequence numbers to keep
+    pub sequence_numbers: Option<RangeInclusive<SequenceNumber>>,
+    /// Keep packets whose beginning to end timestamp range (cycles) overlaps this one.
+    /// The packet context timestamps are compared as-is, without rollover tracking.
+    pub timestamps: Option<RangeInclusive<Timestamp>>,
+}
+
+impl PacketFilter {
+    pub fn matches(&self, header: &PacketHeader, context: &PacketContext) -> bool {
+        if let Some(streams) = &self.streams {
+            if !streams.contains(&header.stream_id) {
+                return false;
+            }
+        }
+        if let (Some(range), Some(seq)) = (&self.sequence_numbers, context.sequence_number) {
+            if !range.contains(&seq) {
+                return false;
+            }
+        }
+        if let Some(range) = &self.timestamps {
+            let begin = context.beginning_timestamp.or(context.end_timestamp);
+            let end = context.end_timestamp.or(context.beginning_timestamp);
+            if let (Some(begin), Some(end)) = (begin, end) {
+                if end < *range.start() || begin > *range.end() {
+                    return false;
+                }
+            }
+        }
+        true
+    }
+}
+
+/// Outcome of [`Parser::slice`]
+#[derive(Copy, Clone, Debug, Default, PartialEq, Eq)]
+pub struct SliceSummary {
+    /// Packets read from the input
+    pub packets_read: u64,
+    /// Packets copied to the output
+    pub packets_written: u64,
+    /// Bytes copied to the output
+    pub bytes_written: u64,
+}
+
+impl Parser {
+    /// Copy the packets of `r` selected by `filter` to `w`, byte for byte.
+    ///
+    /// Only the packet headers and contexts are decoded, the rest of each packet
+    /// is copied or skipped as-is. The output is a valid stream for the same
+    /// configuration.
+    /// [`Parser::stream_stats`] and [`Parser::counters`] aren't updated.
+    pub fn slice<R: Read, W: Write>(
+        &self,
+        mut r: R,
+        mut w: W,
+        filter: &PacketFilter,
+    ) -> Result<SliceSummary, Error> {
+        let mut summary = SliceSummary::default();
+        let mut preamble = Vec::new();
+
+        while let Some((header, context, remaining)) = self.read_preamble(&mut r, &mut preamble)? {
+            summary.packets_read += 1;
+
+            let copied = if filter.matches(&header, &context) {
+                w.write_all(&preamble)?;
+                let n = io::copy(&mut (&mut r).take(remaining), &mut w)?;
+                summary.packets_written += 1;
+                summary.bytes_written += (preamble.len() as u64) + n;
+                n
+            } else {
+                io::copy(&mut (&mut r).take(remaining), &mut io::sink())?
+            };
+            if copied != remaining {
+                return Err(io::Error::from(io::ErrorKind::UnexpectedEof).into());
+            }
+        }
+
+        w.flush()?;
+        Ok(summary)
+    }
+
+    /// Read the next packet's header and context into `preamble`, returning them along
+    /// with the number of bytes left in the packet, or `None` at the end of `r`.
+    /// The stream may only end on a packet boundary.
+    pub(crate) fn read_preamble<R: Read>(
+        &self,
+        r: &mut R,
+        preamble: &mut Vec<u8>,
+    ) -> Result<Option<(PacketHeader, PacketContext, u64)>, Error> {
+        let header_bytes = self.pkt_header.wire_size_hint.cursor_bytes();
+        preamble.resize(header_bytes, 0);
+        match read_fully(r, preamble)? {
+            0 => return Ok(None),
+            n if n < header_bytes => {
+                return Err(io::Error::from(io::ErrorKind::UnexpectedEof).into())
+            }
+            _ => (),
+        }
+
+        let mut hr = StreamReader::new(self.byte_order, preamble.as_slice());
+        let header = self.parse_header(&mut hr)?;
+        let stream = self
+            .streams
+            .get(&header.stream_id)
+            .ok_or(Error::UndefinedStreamId(header.stream_id))?;
+
+        preamble.resize(stream.packet_context.wire_size_hint.cursor_bytes(), 0);
+        r.read_exact(&mut preamble[header_bytes..])?;
+        let (header, context, _) = self.parse_packet_preamble(preamble)?;
+
+        let remaining =
+            context
+                .packet_size()
+                .checked_sub(preamble.len())
+                .ok_or(Error::InvalidPacketSize(
+                    context.packet_size_bits,
+                    context.content_size_bits,
+                ))? as u64;
+        Ok(Some((header, context, remaining)))
+    }
+}
+
+/// Read until `buf` is full or the end of `r`, returning the number of bytes read
+pub(super) fn read_fully<R: Read>(r: &mut R, buf: &mut [u8]) -> io::Result<usize> {
+    let mut n = 0;
+    while n < buf.len() {
+        match r.read(&mut buf[n..]) {
+            Ok(0) => break,
+            Ok(len) => n += len,
+            Err(e) if e.kind() == io::ErrorKind::Interrupted => (),
+            Err(e) => return Err(e),
+        }
+    }
+    Ok(n)
+}
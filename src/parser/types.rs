@@ -1,15 +1,25 @@
 use crate::{
     config::{
-        EnumerationFieldTypeMappingSequence, FeaturesUnsignedIntegerFieldType, FieldType,
-        NativeByteOrder, PreferredDisplayBase, PrimitiveFieldType, StructureMemberFieldType,
-        UnsignedIntegerFieldType,
+        FeaturesUnsignedIntegerFieldType, FieldType, NativeByteOrder, PrimitiveFieldType,
+        StructureMemberFieldType, UnsignedIntegerFieldType,
     },
     error::Error,
-    types::{EventId, FieldValue, PrimitiveFieldValue},
+    parser::visitor::EventVisitor,
+    types::{
+        profile::EventProfileTracker, stats::StreamStatsTracker, ArrayFieldValue, EventId,
+        EventSchema, FieldSchema, FieldValue, PacketContext, PrimitiveFieldValue, StreamId,
+        TrackingInstant,
+    },
 };
 use byteordered::{byteorder::ReadBytesExt, ByteOrdered, Endianness};
 use fxhash::FxHashMap;
 use internment::Intern;
+use ordered_float::OrderedFloat;
+use std::{
+    borrow::Cow,
+    io::{self, Read},
+    sync::{Arc, Mutex, PoisonError},
+};
 use uuid::Uuid;
 
 #[derive(Debug)]
@@ -129,6 +139,57 @@ pub struct StreamParser {
     pub event_header: EventHeaderParser,
     pub common_context: Option<EventPayloadParser>,
     pub events: FxHashMap<EventId, EventParser>,
+    /// Initial event timestamp tracker, see [`StreamClocks`]
+    pub clock: TrackingInstant,
+    pub stats: Mutex<StreamStatsTracker>,
+    /// Time and size each event, see [`Parser::with_profiling`](crate::Parser::with_profiling)
+    pub profiling: bool,
+}
+
+impl StreamParser {
+    /// A clock for decoding the events of a packet on its own, seeded from the
+    /// packet's beginning timestamp when there is one
+    pub fn packet_clock(&self, context: &PacketContext) -> TrackingInstant {
+        let mut clock = self.clock.clone();
+        if let Some(ts) = context.beginning_timestamp {
+            clock.reset_to_timestamp(ts);
+        }
+        clock
+    }
+
+    /// Account for a decoded packet in the stream's stats
+    pub fn record_packet(&self, context: &PacketContext) {
+        self.stats
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner)
+            .record(context);
+    }
+}
+
+/// Event timestamp trackers of a single input, one per stream, carried over from
+/// packet to packet
+#[derive(Debug, Default)]
+pub struct StreamClocks(FxHashMap<StreamId, TrackingInstant>);
+
+impl StreamClocks {
+    /// The stream's clock for decoding the events of a packet, re-seeded from the
+    /// packet's beginning timestamp when there is one, otherwise carried over from
+    /// the stream's previous packet
+    pub fn packet_clock(
+        &mut self,
+        stream_id: StreamId,
+        stream: &StreamParser,
+        context: &PacketContext,
+    ) -> &mut TrackingInstant {
+        let clock = self
+            .0
+            .entry(stream_id)
+            .or_insert_with(|| stream.clock.clone());
+        if let Some(ts) = context.beginning_timestamp {
+            clock.reset_to_timestamp(ts);
+        }
+        clock
+    }
 }
 
 #[derive(Debug)]
@@ -140,10 +201,14 @@ pub struct EventHeaderParser {
 
 #[derive(Debug)]
 pub struct EventParser {
-    pub event_name: Intern<String>,
-    pub log_level: Option<i32>,
+    pub schema: Intern<EventSchema>,
     pub specific_context: Option<EventPayloadParser>,
     pub payload: Option<EventPayloadParser>,
+    /// Upper bound of the common context, specific context and payload wire size,
+    /// for events without variable-size members
+    pub max_wire_size: Option<usize>,
+    /// Decode cost, when the stream is profiled
+    pub profile: EventProfileTracker,
 }
 
 #[derive(Debug)]
@@ -152,81 +217,52 @@ pub struct EventPayloadParser {
     pub members: Vec<EventPayloadMemberParser>,
 }
 
-#[derive(Debug)]
-pub struct EnumerationMappings(pub Vec<(Intern<String>, Vec<EnumerationFieldTypeMappingSequence>)>);
-
-impl EnumerationMappings {
-    pub(crate) fn from_struct_ft(ft: &StructureMemberFieldType) -> Option<Self> {
-        match ft {
-            StructureMemberFieldType::UnsignedEnumeration(t)
-            | StructureMemberFieldType::SignedEnumeration(t) => {
-                let mut mappings = Vec::new();
-                for (label, seq) in t.mappings.iter() {
-                    mappings.push((Intern::new(label.clone()), seq.clone()));
-                }
-                Some(Self(mappings))
-            }
-            _ => None,
-        }
+impl EventPayloadParser {
+    pub fn schemas(&self) -> Vec<Intern<FieldSchema>> {
+        self.members.iter().map(|m| m.schema).collect()
     }
 
-    pub fn label(&self, v: i64) -> Option<Intern<String>> {
-        self.0
+    /// See [`FieldTypeParser::max_wire_size`]
+    pub fn max_wire_size(&self) -> Option<usize> {
+        self.members
             .iter()
-            .find_map(|(label, values)| values.iter().any(|s| s.contains(v)).then_some(*label))
+            .try_fold(self.alignment.bytes() - 1, |size, m| {
+                Some(size + m.value.max_wire_size()?)
+            })
     }
 }
 
 #[derive(Debug)]
 pub struct EventPayloadMemberParser {
-    pub member_name: Intern<String>,
-    pub preferred_display_base: Option<PreferredDisplayBase>,
-    pub enum_mappings: Option<EnumerationMappings>,
+    pub schema: Intern<FieldSchema>,
     pub value: FieldTypeParser,
 }
 
 impl EventPayloadMemberParser {
-    pub fn parse<T: ReadBytesExt>(&self, r: &mut StreamReader<T>) -> Result<FieldValue, Error> {
-        // Parse the value, add preferred display base, if any
-        let val = match self.value.parse(r)? {
-            FieldValue::Primitive(PrimitiveFieldValue::UnsignedInteger(v, _)) => {
-                FieldValue::Primitive(PrimitiveFieldValue::UnsignedInteger(
-                    v,
-                    self.preferred_display_base.unwrap_or_default(),
-                ))
-            }
-            FieldValue::Primitive(PrimitiveFieldValue::SignedInteger(v, _)) => {
-                FieldValue::Primitive(PrimitiveFieldValue::SignedInteger(
-                    v,
-                    self.preferred_display_base.unwrap_or_default(),
-                ))
-            }
-            val => val,
-        };
+    pub fn new(
+        member_name: &str,
+        ft: &StructureMemberFieldType,
+    ) -> Result<Self, FieldUnsupportedError> {
+        Ok(Self {
+            schema: Intern::new(FieldSchema::from_struct_ft(member_name, ft)),
+            value: FieldTypeParser::from_ft(ft)?,
+        })
+    }
 
-        // Attempt to extract an enum value label, if any
-        if let Some(mappings) = &self.enum_mappings {
-            match val {
-                // NOTE: we always convert unsigned enums to signed
-                FieldValue::Primitive(PrimitiveFieldValue::UnsignedInteger(v, pdb)) => {
-                    Ok(FieldValue::Primitive(PrimitiveFieldValue::Enumeration(
-                        v as i64,
-                        pdb,
-                        mappings.label(v as i64),
-                    )))
-                }
-                FieldValue::Primitive(PrimitiveFieldValue::SignedInteger(v, pdb)) => {
-                    Ok(FieldValue::Primitive(PrimitiveFieldValue::Enumeration(
-                        v,
-                        pdb,
-                        mappings.label(v),
-                    )))
-                }
-                val => Ok(val),
-            }
-        } else {
-            Ok(val)
-        }
+    pub fn parse<T: ByteSource>(&self, r: &mut StreamReader<T>) -> Result<FieldValue, Error> {
+        self.value.parse(r)
+    }
+
+    pub fn parse_bounded(&self, r: &mut BoundedReader) -> FieldValue {
+        self.value.parse_bounded(r)
+    }
+
+    pub fn visit<T: ByteSource, V: EventVisitor + ?Sized>(
+        &self,
+        r: &mut StreamReader<T>,
+        v: &mut V,
+    ) -> Result<(), Error> {
+        self.value.visit(r, &self.schema, v)
     }
 }
 
@@ -249,7 +285,7 @@ impl Size {
         })
     }
 
-    fn bits(&self) -> usize {
+    pub fn bits(&self) -> usize {
         match self {
             Self::Bits8 => 8,
             Self::Bits16 => 16,
@@ -257,6 +293,15 @@ impl Size {
             Self::Bits64 => 64,
         }
     }
+
+    pub fn bytes(&self) -> usize {
+        self.bits() >> 3
+    }
+
+    /// Largest unsigned value of this size
+    pub fn max_value(&self) -> u64 {
+        u64::MAX >> (64 - self.bits())
+    }
 }
 
 #[derive(Copy, Clone, Eq, PartialEq, Ord, PartialOrd, Hash, Debug)]
@@ -366,23 +411,109 @@ impl PrimitiveFieldTypeParser {
         }
     }
 
-    pub fn parse<T: ReadBytesExt>(
+    /// Upper bound of the wire size in bytes, including alignment padding.
+    /// `None` for strings, and reals of an unsupported size.
+    pub fn max_wire_size(&self) -> Option<usize> {
+        match self {
+            Self::String(_) => None,
+            Self::Real(desc) if desc.size < Size::Bits32 => None,
+            _ => Some(self.desc().alignment.bytes() - 1 + self.desc().size.bytes()),
+        }
+    }
+
+    /// Read a value of a type with a [`PrimitiveFieldTypeParser::max_wire_size`]
+    pub fn parse_bounded(&self, r: &mut BoundedReader) -> PrimitiveFieldValue {
+        match self {
+            Self::UInt(desc) => match desc.size {
+                Size::Bits8 => r.read::<u8>(desc.alignment).into(),
+                Size::Bits16 => r.read::<u16>(desc.alignment).into(),
+                Size::Bits32 => r.read::<u32>(desc.alignment).into(),
+                Size::Bits64 => r.read::<u64>(desc.alignment).into(),
+            },
+            Self::Int(desc) => match desc.size {
+                Size::Bits8 => r.read::<i8>(desc.alignment).into(),
+                Size::Bits16 => r.read::<i16>(desc.alignment).into(),
+                Size::Bits32 => r.read::<i32>(desc.alignment).into(),
+                Size::Bits64 => r.read::<i64>(desc.alignment).into(),
+            },
+            // NOTE: we always convert unsigned enums to signed
+            Self::UEnum(desc) => PrimitiveFieldValue::Enumeration(match desc.size {
+                Size::Bits8 => r.read::<u8>(desc.alignment).into(),
+                Size::Bits16 => r.read::<u16>(desc.alignment).into(),
+                Size::Bits32 => r.read::<u32>(desc.alignment).into(),
+                Size::Bits64 => r.read::<u64>(desc.alignment) as i64,
+            }),
+            Self::Enum(desc) => PrimitiveFieldValue::Enumeration(match desc.size {
+                Size::Bits8 => r.read::<i8>(desc.alignment).into(),
+                Size::Bits16 => r.read::<i16>(desc.alignment).into(),
+                Size::Bits32 => r.read::<i32>(desc.alignment).into(),
+                Size::Bits64 => r.read::<i64>(desc.alignment),
+            }),
+            Self::Real(desc) if desc.size == Size::Bits32 => {
+                PrimitiveFieldValue::F32(r.read(desc.alignment))
+            }
+            Self::Real(desc) if desc.size == Size::Bits64 => {
+                PrimitiveFieldValue::F64(r.read(desc.alignment))
+            }
+            Self::String(_) | Self::Real(_) => unreachable!("No max wire size"),
+        }
+    }
+
+    /// Read an array of a type with a [`PrimitiveFieldTypeParser::max_wire_size`]
+    pub fn parse_array_bounded(&self, r: &mut BoundedReader, len: usize) -> ArrayFieldValue {
+        match self {
+            Self::UInt(desc) | Self::UEnum(desc) => match desc.size {
+                Size::Bits8 => ArrayFieldValue::U8(r.read_array(desc.alignment, len)),
+                Size::Bits16 => ArrayFieldValue::U16(r.read_array(desc.alignment, len)),
+                Size::Bits32 => ArrayFieldValue::U32(r.read_array(desc.alignment, len)),
+                Size::Bits64 => ArrayFieldValue::U64(r.read_array(desc.alignment, len)),
+            },
+            Self::Int(desc) | Self::Enum(desc) => match desc.size {
+                Size::Bits8 => ArrayFieldValue::I8(r.read_array(desc.alignment, len)),
+                Size::Bits16 => ArrayFieldValue::I16(r.read_array(desc.alignment, len)),
+                Size::Bits32 => ArrayFieldValue::I32(r.read_array(desc.alignment, len)),
+                Size::Bits64 => ArrayFieldValue::I64(r.read_array(desc.alignment, len)),
+            },
+            Self::Real(desc) if desc.size == Size::Bits32 => {
+                ArrayFieldValue::F32(r.read_array(desc.alignment, len))
+            }
+            Self::Real(desc) if desc.size == Size::Bits64 => {
+                ArrayFieldValue::F64(r.read_array(desc.alignment, len))
+            }
+            Self::String(_) | Self::Real(_) => unreachable!("No max wire size"),
+        }
+    }
+
+    pub fn parse<T: ByteSource>(
         &self,
         r: &mut StreamReader<T>,
     ) -> Result<PrimitiveFieldValue, Error> {
         Ok(match self {
-            Self::UInt(desc) | Self::UEnum(desc) => match desc.size {
+            Self::UInt(desc) => match desc.size {
                 Size::Bits8 => r.read_u8(desc.alignment)?.into(),
                 Size::Bits16 => r.read_u16(desc.alignment)?.into(),
                 Size::Bits32 => r.read_u32(desc.alignment)?.into(),
                 Size::Bits64 => r.read_u64(desc.alignment)?.into(),
             },
-            Self::Int(desc) | Self::Enum(desc) => match desc.size {
+            Self::Int(desc) => match desc.size {
                 Size::Bits8 => r.read_i8(desc.alignment)?.into(),
                 Size::Bits16 => r.read_i16(desc.alignment)?.into(),
                 Size::Bits32 => r.read_i32(desc.alignment)?.into(),
                 Size::Bits64 => r.read_i64(desc.alignment)?.into(),
             },
+            // NOTE: we always convert unsigned enums to signed
+            Self::UEnum(desc) => PrimitiveFieldValue::Enumeration(match desc.size {
+                Size::Bits8 => r.read_u8(desc.alignment)?.into(),
+                Size::Bits16 => r.read_u16(desc.alignment)?.into(),
+                Size::Bits32 => r.read_u32(desc.alignment)?.into(),
+                Size::Bits64 => r.read_u64(desc.alignment)? as i64,
+            }),
+            Self::Enum(desc) => PrimitiveFieldValue::Enumeration(match desc.size {
+                Size::Bits8 => r.read_i8(desc.alignment)?.into(),
+                Size::Bits16 => r.read_i16(desc.alignment)?.into(),
+                Size::Bits32 => r.read_i32(desc.alignment)?.into(),
+                Size::Bits64 => r.read_i64(desc.alignment)?,
+            }),
             Self::String(_) => r.read_string()?.into(),
             Self::Real(desc) => match desc.size {
                 Size::Bits32 => r.read_f32(desc.alignment)?.into(),
@@ -391,6 +522,98 @@ impl PrimitiveFieldTypeParser {
             },
         })
     }
+
+    /// Read a value of this type and hand it to the visitor
+    pub fn visit<T: ByteSource, V: EventVisitor + ?Sized>(
+        &self,
+        r: &mut StreamReader<T>,
+        member: &FieldSchema,
+        v: &mut V,
+    ) -> Result<(), Error> {
+        match self {
+            Self::UInt(desc) => v.on_u64(
+                member,
+                match desc.size {
+                    Size::Bits8 => r.read_u8(desc.alignment)?.into(),
+                    Size::Bits16 => r.read_u16(desc.alignment)?.into(),
+                    Size::Bits32 => r.read_u32(desc.alignment)?.into(),
+                    Size::Bits64 => r.read_u64(desc.alignment)?,
+                },
+            ),
+            Self::Int(desc) => v.on_i64(
+                member,
+                match desc.size {
+                    Size::Bits8 => r.read_i8(desc.alignment)?.into(),
+                    Size::Bits16 => r.read_i16(desc.alignment)?.into(),
+                    Size::Bits32 => r.read_i32(desc.alignment)?.into(),
+                    Size::Bits64 => r.read_i64(desc.alignment)?,
+                },
+            ),
+            // NOTE: we always convert unsigned enums to signed
+            Self::UEnum(desc) => v.on_enum(
+                member,
+                match desc.size {
+                    Size::Bits8 => r.read_u8(desc.alignment)?.into(),
+                    Size::Bits16 => r.read_u16(desc.alignment)?.into(),
+                    Size::Bits32 => r.read_u32(desc.alignment)?.into(),
+                    Size::Bits64 => r.read_u64(desc.alignment)? as i64,
+                },
+            ),
+            Self::Enum(desc) => v.on_enum(
+                member,
+                match desc.size {
+                    Size::Bits8 => r.read_i8(desc.alignment)?.into(),
+                    Size::Bits16 => r.read_i16(desc.alignment)?.into(),
+                    Size::Bits32 => r.read_i32(desc.alignment)?.into(),
+                    Size::Bits64 => r.read_i64(desc.alignment)?,
+                },
+            ),
+            Self::String(_) => v.on_str(member, &r.read_str()?),
+            Self::Real(desc) => v.on_f64(
+                member,
+                match desc.size {
+                    Size::Bits32 => r.read_f32(desc.alignment)?.into(),
+                    Size::Bits64 => r.read_f64(desc.alignment)?,
+                    _ => return Err(Error::InvalidFloatSize(desc.size.bits())),
+                },
+            ),
+        }
+        Ok(())
+    }
+
+    /// Read `len` consecutive elements of this type into a typed array
+    pub fn parse_array<T: ByteSource>(
+        &self,
+        r: &mut StreamReader<T>,
+        len: usize,
+    ) -> Result<ArrayFieldValue, Error> {
+        Ok(match self {
+            Self::UInt(desc) | Self::UEnum(desc) => match desc.size {
+                Size::Bits8 => ArrayFieldValue::U8(r.read_array(desc.alignment, len)?),
+                Size::Bits16 => ArrayFieldValue::U16(r.read_array(desc.alignment, len)?),
+                Size::Bits32 => ArrayFieldValue::U32(r.read_array(desc.alignment, len)?),
+                Size::Bits64 => ArrayFieldValue::U64(r.read_array(desc.alignment, len)?),
+            },
+            Self::Int(desc) | Self::Enum(desc) => match desc.size {
+                Size::Bits8 => ArrayFieldValue::I8(r.read_array(desc.alignment, len)?),
+                Size::Bits16 => ArrayFieldValue::I16(r.read_array(desc.alignment, len)?),
+                Size::Bits32 => ArrayFieldValue::I32(r.read_array(desc.alignment, len)?),
+                Size::Bits64 => ArrayFieldValue::I64(r.read_array(desc.alignment, len)?),
+            },
+            Self::String(_) => {
+                let mut arr = Vec::new();
+                for _ in 0..len {
+                    arr.push(r.read_string()?);
+                }
+                ArrayFieldValue::String(arr)
+            }
+            Self::Real(desc) => match desc.size {
+                Size::Bits32 => ArrayFieldValue::F32(r.read_array(desc.alignment, len)?),
+                Size::Bits64 => ArrayFieldValue::F64(r.read_array(desc.alignment, len)?),
+                _ => return Err(Error::InvalidFloatSize(desc.size.bits())),
+            },
+        })
+    }
 }
 
 #[derive(Copy, Clone, Eq, PartialEq, Ord, PartialOrd, Hash, Debug)]
@@ -441,7 +664,39 @@ impl FieldTypeParser {
         }
     }
 
-    pub fn parse<T: ReadBytesExt>(&self, r: &mut StreamReader<T>) -> Result<FieldValue, Error> {
+    /// Upper bound of the wire size in bytes, including alignment padding, for
+    /// fixed-size types. `None` for strings and dynamic arrays.
+    pub fn max_wire_size(&self) -> Option<usize> {
+        match self {
+            Self::Primitive(p) => p.max_wire_size(),
+            Self::StaticArray(len, p) => {
+                let desc = p.desc();
+                p.max_wire_size()?;
+                // Elements are padded out to their alignment
+                let stride = desc.size.bytes().max(desc.alignment.bytes());
+                len.checked_mul(stride)?
+                    .checked_add(desc.alignment.bytes() - 1)
+            }
+            Self::DynamicArray(_) => None,
+        }
+    }
+
+    /// Read a value of a type with a [`FieldTypeParser::max_wire_size`]
+    pub fn parse_bounded(&self, r: &mut BoundedReader) -> FieldValue {
+        match self {
+            Self::Primitive(p) => p.parse_bounded(r).into(),
+            Self::StaticArray(len, p) => {
+                // Align for field
+                r.align_to(p.desc().alignment);
+
+                // Align for and read elements
+                p.parse_array_bounded(r, *len).into()
+            }
+            Self::DynamicArray(_) => unreachable!("No max wire size"),
+        }
+    }
+
+    pub fn parse<T: ByteSource>(&self, r: &mut StreamReader<T>) -> Result<FieldValue, Error> {
         match self {
             Self::Primitive(p) => Ok(p.parse(r)?.into()),
             Self::StaticArray(len, p) => {
@@ -449,11 +704,7 @@ impl FieldTypeParser {
                 r.align_to(p.desc().alignment)?;
 
                 // Align for and read elements
-                let mut arr = Vec::new();
-                for _ in 0..*len {
-                    arr.push(p.parse(r)?);
-                }
-                Ok(FieldValue::Array(arr))
+                Ok(p.parse_array(r, *len)?.into())
             }
             Self::DynamicArray(p) => {
                 // NOTE: the u32 len field is always byte-packed
@@ -465,13 +716,38 @@ impl FieldTypeParser {
                 r.align_to(p.desc().alignment)?;
 
                 // Align for and read elements
-                let mut arr = Vec::new();
-                for _ in 0..len {
-                    arr.push(p.parse(r)?);
-                }
-                Ok(FieldValue::Array(arr))
+                Ok(p.parse_array(r, len as usize)?.into())
+            }
+        }
+    }
+
+    /// Read a value of this type and hand it to the visitor, array elements
+    /// are visited one at a time
+    pub fn visit<T: ByteSource, V: EventVisitor + ?Sized>(
+        &self,
+        r: &mut StreamReader<T>,
+        member: &FieldSchema,
+        v: &mut V,
+    ) -> Result<(), Error> {
+        let (len, p) = match self {
+            Self::Primitive(p) => return p.visit(r, member, v),
+            Self::StaticArray(len, p) => (*len, p),
+            Self::DynamicArray(p) => {
+                // NOTE: the u32 len field is always byte-packed
+                (r.read_u32(Size::Bits8)? as usize, p)
             }
+        };
+
+        // Align for field
+        r.align_to(p.desc().alignment)?;
+
+        // Align for and read elements
+        v.on_array_begin(member, len);
+        for _ in 0..len {
+            p.visit(r, member, v)?;
         }
+        v.on_array_end(member);
+        Ok(())
     }
 }
 
@@ -503,7 +779,12 @@ impl AlignedCursor {
 
         // Compute the next alignment/padding
         let next_index = (self.bit_index + (align_bits - 1)) & (!align_bits + 1);
-        tracing::trace!(align = align_bits, index = self.bit_index, next_index,);
+        decode_trace!(
+            trace,
+            align = align_bits,
+            index = self.bit_index,
+            next_index
+        );
         debug_assert!(next_index % 8 == 0);
 
         // Offset the cursor if necessary
@@ -522,15 +803,210 @@ impl AlignedCursor {
     pub fn increment(&mut self, size: Size) {
         self.bit_index += size.bits();
     }
+
+    /// Increment the cursor by a number of bytes
+    pub fn increment_bytes(&mut self, bytes: usize) {
+        self.bit_index += bytes << 3;
+    }
+}
+
+/// Byte sources the [`StreamReader`] can decode from.
+/// In-memory packet buffers get a zero-copy fast path, while
+/// generic IO readers fall back to reading one byte at a time.
+pub trait ByteSource: ReadBytesExt {
+    /// Read a NUL-terminated string, consuming the terminator.
+    /// The returned bytes don't include the terminator.
+    fn read_cstr(&mut self) -> io::Result<Cow<'_, [u8]>>;
+
+    /// Read exactly `len` bytes.
+    fn read_bytes(&mut self, len: usize) -> io::Result<Cow<'_, [u8]>>;
+
+    /// The next `len` bytes, without consuming them, when they're held in memory
+    fn peek(&self, len: usize) -> Option<&[u8]>;
 }
 
+impl ByteSource for &[u8] {
+    fn read_cstr(&mut self) -> io::Result<Cow<'_, [u8]>> {
+        let buf: &[u8] = self;
+        let len = memchr::memchr(0, buf).ok_or(io::ErrorKind::UnexpectedEof)?;
+        *self = &buf[len + 1..];
+        Ok(Cow::Borrowed(&buf[..len]))
+    }
+
+    fn read_bytes(&mut self, len: usize) -> io::Result<Cow<'_, [u8]>> {
+        let buf: &[u8] = self;
+        if buf.len() < len {
+            return Err(io::ErrorKind::UnexpectedEof.into());
+        }
+        let (bytes, rest) = buf.split_at(len);
+        *self = rest;
+        Ok(Cow::Borrowed(bytes))
+    }
+
+    fn peek(&self, len: usize) -> Option<&[u8]> {
+        self.get(..len)
+    }
+}
+
+impl<R: Read + ?Sized> ByteSource for &mut R {
+    fn read_cstr(&mut self) -> io::Result<Cow<'_, [u8]>> {
+        let mut cstr = Vec::new();
+        loop {
+            let b = self.read_u8()?;
+            if b == 0 {
+                break;
+            }
+            cstr.push(b);
+        }
+        Ok(Cow::Owned(cstr))
+    }
+
+    fn read_bytes(&mut self, len: usize) -> io::Result<Cow<'_, [u8]>> {
+        // Don't trust `len` for the allocation, it may come from a corrupt length field
+        let mut bytes = Vec::new();
+        self.take(len as u64).read_to_end(&mut bytes)?;
+        if bytes.len() < len {
+            return Err(io::ErrorKind::UnexpectedEof.into());
+        }
+        Ok(Cow::Owned(bytes))
+    }
+
+    fn peek(&self, _len: usize) -> Option<&[u8]> {
+        None
+    }
+}
+
+/// Fixed-size array elements, decoded in bulk by [`StreamReader::read_array`].
+pub trait ArrayElement: Sized {
+    const SIZE: Size;
+
+    fn from_le_bytes(bytes: &[u8]) -> Self;
+
+    fn from_be_bytes(bytes: &[u8]) -> Self;
+
+    fn read<T: ReadBytesExt>(r: &mut StreamReader<T>, align: Size) -> Result<Self, Error>;
+}
+
+macro_rules! impl_array_element {
+    ($t:ty, $size:ident, $read:ident) => {
+        impl_array_element!($t, $t, $size, $read);
+    };
+    ($t:ty, $prim:ty, $size:ident, $read:ident) => {
+        impl ArrayElement for $t {
+            const SIZE: Size = Size::$size;
+
+            fn from_le_bytes(bytes: &[u8]) -> Self {
+                // SAFETY: callers always hand over SIZE bytes
+                <$prim>::from_le_bytes(bytes.try_into().unwrap()).into()
+            }
+
+            fn from_be_bytes(bytes: &[u8]) -> Self {
+                // SAFETY: callers always hand over SIZE bytes
+                <$prim>::from_be_bytes(bytes.try_into().unwrap()).into()
+            }
+
+            fn read<T: ReadBytesExt>(r: &mut StreamReader<T>, align: Size) -> Result<Self, Error> {
+                Ok(r.$read(align)?.into())
+            }
+        }
+    };
+}
+
+impl_array_element!(u8, Bits8, read_u8);
+impl_array_element!(u16, Bits16, read_u16);
+impl_array_element!(u32, Bits32, read_u32);
+impl_array_element!(u64, Bits64, read_u64);
+impl_array_element!(i8, Bits8, read_i8);
+impl_array_element!(i16, Bits16, read_i16);
+impl_array_element!(i32, Bits32, read_i32);
+impl_array_element!(i64, Bits64, read_i64);
+impl_array_element!(OrderedFloat<f32>, f32, Bits32, read_f32);
+impl_array_element!(OrderedFloat<f64>, f64, Bits64, read_f64);
+
+/// Infallible reads from a buffer already checked to hold everything read,
+/// see [`StreamReader::read_bounded`].
+/// Reading past the buffer is a bug, and panics.
 #[derive(Debug)]
-pub struct StreamReader<T> {
+pub struct BoundedReader<'a> {
+    buf: &'a [u8],
+    byte_order: Endianness,
+    cursor: AlignedCursor,
+}
+
+impl BoundedReader<'_> {
+    pub fn align_to(&mut self, align: Size) {
+        let padding_bytes = self.cursor.align_to(align) >> 3;
+        self.buf = &self.buf[padding_bytes..];
+    }
+
+    pub fn read<V: ArrayElement>(&mut self, align: Size) -> V {
+        self.align_to(align);
+        let (bytes, rest) = self.buf.split_at(V::SIZE.bytes());
+        self.buf = rest;
+        self.cursor.increment(V::SIZE);
+        match self.byte_order {
+            Endianness::Little => V::from_le_bytes(bytes),
+            Endianness::Big => V::from_be_bytes(bytes),
+        }
+    }
+
+    /// See [`StreamReader::read_array`]
+    pub fn read_array<V: ArrayElement>(&mut self, align: Size, len: usize) -> Vec<V> {
+        if align > V::SIZE {
+            return (0..len).map(|_| self.read(align)).collect();
+        }
+
+        self.align_to(align);
+        let (bytes, rest) = self.buf.split_at(len * V::SIZE.bytes());
+        self.buf = rest;
+        self.cursor.increment_bytes(bytes.len());
+        let chunks = bytes.chunks_exact(V::SIZE.bytes());
+        match self.byte_order {
+            Endianness::Little => chunks.map(V::from_le_bytes).collect(),
+            Endianness::Big => chunks.map(V::from_be_bytes).collect(),
+        }
+    }
+}
+
+/// Per-parser string dedup cache, keyed by the raw bytes in the packet buffer.
+/// Repeated values cost a hash probe and a reference count bump instead of an allocation.
+/// Once `capacity` distinct strings are cached, new values are decoded as usual
+/// but not retained.
+#[derive(Debug)]
+pub struct StringCache {
+    capacity: usize,
+    strings: FxHashMap<Box<[u8]>, Arc<str>>,
+}
+
+impl StringCache {
+    pub fn new(capacity: usize) -> Self {
+        Self {
+            capacity,
+            strings: FxHashMap::default(),
+        }
+    }
+
+    pub fn get_or_insert(&mut self, bytes: &[u8]) -> Arc<str> {
+        if let Some(s) = self.strings.get(bytes) {
+            return s.clone();
+        }
+        let s: Arc<str> = String::from_utf8_lossy(bytes).into();
+        if self.strings.len() < self.capacity {
+            self.strings.insert(bytes.into(), s.clone());
+        }
+        s
+    }
+}
+
+#[derive(Debug)]
+pub struct StreamReader<'s, T> {
     pub inner: ByteOrdered<T, Endianness>,
+    pub byte_order: Endianness,
     pub cursor: AlignedCursor,
+    pub strings: Option<&'s mut StringCache>,
 }
 
-impl<T> StreamReader<T>
+impl<'s, T> StreamReader<'s, T>
 where
     T: ReadBytesExt,
 {
@@ -541,13 +1017,20 @@ where
     pub fn new_with_cursor(byte_order: NativeByteOrder, cursor: AlignedCursor, r: T) -> Self {
         Self {
             inner: ByteOrdered::runtime(r, byte_order.into()),
+            byte_order: byte_order.into(),
             cursor,
+            strings: None,
         }
     }
 
+    /// Decode string fields through the given dedup cache, if any
+    pub fn with_string_cache(mut self, strings: Option<&'s mut StringCache>) -> Self {
+        self.strings = strings;
+        self
+    }
+
     pub fn into_cursor(self) -> AlignedCursor {
-        let StreamReader { inner: _, cursor } = self;
-        cursor
+        self.cursor
     }
 
     pub fn cursor_bits(&self) -> usize {
@@ -633,18 +1116,221 @@ where
         self.cursor.increment(Size::Bits64);
         Ok(val)
     }
+}
 
-    pub fn read_string(&mut self) -> Result<String, Error> {
-        let mut cstr = Vec::new();
-        self.align_to(Size::Bits8)?;
-        loop {
-            let b = self.inner.read_u8()?;
-            self.cursor.increment(Size::Bits8);
-            if b == 0 {
-                break;
+impl<T> StreamReader<'_, T>
+where
+    T: ByteSource,
+{
+    /// Read `len` consecutive elements.
+    /// When elements are packed back to back (alignment no larger than
+    /// the element size), they're converted in bulk from a single read.
+    pub fn read_array<V: ArrayElement>(
+        &mut self,
+        align: Size,
+        len: usize,
+    ) -> Result<Vec<V>, Error> {
+        if align > V::SIZE {
+            // Padding between elements, go one at a time
+            let mut arr = Vec::new();
+            for _ in 0..len {
+                arr.push(V::read(self, align)?);
             }
-            cstr.push(b);
+            return Ok(arr);
+        }
+
+        self.align_to(align)?;
+        let elem_bytes = V::SIZE.bits() >> 3;
+        let num_bytes = len
+            .checked_mul(elem_bytes)
+            .ok_or(io::Error::from(io::ErrorKind::UnexpectedEof))?;
+        let bytes = self.inner.inner_mut().read_bytes(num_bytes)?;
+        self.cursor.increment_bytes(num_bytes);
+        let chunks = bytes.chunks_exact(elem_bytes);
+        Ok(match self.byte_order {
+            Endianness::Little => chunks.map(V::from_le_bytes).collect(),
+            Endianness::Big => chunks.map(V::from_be_bytes).collect(),
+        })
+    }
+
+    /// Decode through a [`BoundedReader`] over the next `len` bytes, when the source
+    /// holds them in memory, leaving the reader past the bytes `f` consumed.
+    /// Returns `None` without reading anything otherwise.
+    pub fn read_bounded<V>(
+        &mut self,
+        len: usize,
+        f: impl FnOnce(&mut BoundedReader<'_>) -> V,
+    ) -> Option<V> {
+        let mut b = BoundedReader {
+            // Not through auto-ref, `&mut T` is a source too
+            buf: T::peek(self.inner.inner_mut(), len)?,
+            byte_order: self.byte_order,
+            cursor: self.cursor,
+        };
+        let val = f(&mut b);
+        let cursor = b.cursor;
+        let consumed = cursor.cursor_bytes() - self.cursor.cursor_bytes();
+        // SAFETY: within the peeked bytes
+        self.inner.inner_mut().read_bytes(consumed).unwrap();
+        self.cursor = cursor;
+        Some(val)
+    }
+
+    /// Read a NUL-terminated string, borrowing from the packet buffer when possible
+    pub fn read_str(&mut self) -> Result<Cow<'_, str>, Error> {
+        self.align_to(Size::Bits8)?;
+        let cstr = self.inner.inner_mut().read_cstr()?;
+        // Includes the NUL terminator
+        self.cursor.increment_bytes(cstr.len() + 1);
+        Ok(match cstr {
+            Cow::Borrowed(b) => String::from_utf8_lossy(b),
+            Cow::Owned(v) => Cow::Owned(
+                String::from_utf8(v)
+                    .unwrap_or_else(|e| String::from_utf8_lossy(e.as_bytes()).into_owned()),
+            ),
+        })
+    }
+
+    /// Read a NUL-terminated string into a shared handle, going through
+    /// the string cache when one is attached
+    pub fn read_string(&mut self) -> Result<Arc<str>, Error> {
+        if self.strings.is_none() {
+            return Ok(self.read_str()?.into());
+        }
+        self.align_to(Size::Bits8)?;
+        let cstr = self.inner.inner_mut().read_cstr()?;
+        // Includes the NUL terminator
+        self.cursor.increment_bytes(cstr.len() + 1);
+        let strings = self.strings.as_deref_mut().unwrap(); // SAFETY: checked above
+        Ok(strings.get_or_insert(&cstr))
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    const STRINGS: &[u8] = b"\0hello\0w\xF6rld\0";
+
+    #[test]
+    fn read_str_from_packet_buffer() {
+        let mut r = StreamReader::new(NativeByteOrder::LittleEndian, STRINGS);
+        assert!(matches!(r.read_str().unwrap(), Cow::Borrowed("")));
+        assert!(matches!(r.read_str().unwrap(), Cow::Borrowed("hello")));
+        assert_eq!(r.read_str().unwrap(), "w\u{FFFD}rld");
+        assert_eq!(r.cursor_bits(), STRINGS.len() * 8);
+        assert!(r.read_str().is_err());
+    }
+
+    #[test]
+    fn read_string_from_io_reader() {
+        let mut src = STRINGS;
+        let mut r = StreamReader::new(NativeByteOrder::LittleEndian, &mut src);
+        assert_eq!(r.read_string().unwrap().as_ref(), "");
+        assert_eq!(r.read_string().unwrap().as_ref(), "hello");
+        assert_eq!(r.read_string().unwrap().as_ref(), "w\u{FFFD}rld");
+        assert_eq!(r.cursor_bits(), STRINGS.len() * 8);
+        assert!(r.read_string().is_err());
+    }
+
+    #[test]
+    fn string_cache_shares_repeated_values() {
+        let buf = b"task\0task\0idle\0task\0";
+        let mut cache = StringCache::new(1);
+        let mut r = StreamReader::new(NativeByteOrder::LittleEndian, &buf[..])
+            .with_string_cache(Some(&mut cache));
+        let s0 = r.read_string().unwrap();
+        let s1 = r.read_string().unwrap();
+        let s2 = r.read_string().unwrap();
+        let s3 = r.read_string().unwrap();
+        assert_eq!(s0.as_ref(), "task");
+        assert!(Arc::ptr_eq(&s0, &s1));
+        assert!(Arc::ptr_eq(&s0, &s3));
+        // Over capacity, still decoded but not retained
+        assert_eq!(s2.as_ref(), "idle");
+        assert_eq!(cache.strings.len(), 1);
+    }
+
+    #[test]
+    fn bounded_reads_match_checked_reads() {
+        let desc = |size, alignment| FieldDesc { size, alignment };
+        let fields = [
+            FieldTypeParser::Primitive(PrimitiveFieldTypeParser::UInt(desc(
+                Size::Bits8,
+                Size::Bits8,
+            ))),
+            FieldTypeParser::Primitive(PrimitiveFieldTypeParser::Enum(desc(
+                Size::Bits32,
+                Size::Bits32,
+            ))),
+            FieldTypeParser::StaticArray(
+                3,
+                PrimitiveFieldTypeParser::Int(desc(Size::Bits16, Size::Bits32)),
+            ),
+            FieldTypeParser::Primitive(PrimitiveFieldTypeParser::Real(desc(
+                Size::Bits64,
+                Size::Bits64,
+            ))),
+        ];
+        let max_wire_size: usize = fields.iter().map(|f| f.max_wire_size().unwrap()).sum();
+        let buf: Vec<u8> = (0..max_wire_size as u8).collect();
+
+        for byte_order in [NativeByteOrder::LittleEndian, NativeByteOrder::BigEndian] {
+            let mut r = StreamReader::new(byte_order, buf.as_slice());
+            let checked: Vec<_> = fields.iter().map(|f| f.parse(&mut r).unwrap()).collect();
+            let checked_bits = r.cursor_bits();
+
+            let mut r = StreamReader::new(byte_order, buf.as_slice());
+            let bounded = r
+                .read_bounded(max_wire_size, |b| {
+                    fields
+                        .iter()
+                        .map(|f| f.parse_bounded(b))
+                        .collect::<Vec<_>>()
+                })
+                .unwrap();
+            assert_eq!(bounded, checked);
+            assert_eq!(r.cursor_bits(), checked_bits);
         }
-        Ok(String::from_utf8_lossy(&cstr).to_string())
+
+        // Not enough bytes, or not held in memory
+        let mut r = StreamReader::new(NativeByteOrder::LittleEndian, &buf[1..]);
+        assert!(r.read_bounded(max_wire_size, |_| ()).is_none());
+        let mut src = buf.as_slice();
+        let mut r = StreamReader::new(NativeByteOrder::LittleEndian, &mut src);
+        assert!(r.read_bounded(1, |_| ()).is_none());
+    }
+
+    #[test]
+    fn read_array_bulk() {
+        let buf = [0xFF, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x80, 0x3F];
+        let mut r = StreamReader::new(NativeByteOrder::LittleEndian, &buf[..]);
+        assert_eq!(r.read_u8(Size::Bits8).unwrap(), 0xFF);
+        assert_eq!(
+            r.read_array::<u16>(Size::Bits8, 2).unwrap(),
+            vec![0x0001, 0x0002]
+        );
+        assert_eq!(
+            r.read_array::<OrderedFloat<f32>>(Size::Bits8, 1).unwrap(),
+            vec![OrderedFloat(1.0)]
+        );
+        assert_eq!(r.cursor_bits(), buf.len() * 8);
+        assert!(r.read_array::<u16>(Size::Bits8, 1).is_err());
+
+        let mut src = &buf[1..];
+        let mut r = StreamReader::new(NativeByteOrder::BigEndian, &mut src);
+        assert_eq!(
+            r.read_array::<i16>(Size::Bits16, 2).unwrap(),
+            vec![0x0100, 0x0200]
+        );
+        assert!(r.read_array::<u32>(Size::Bits32, 2).is_err());
+    }
+
+    #[test]
+    fn read_array_padded_elements() {
+        let buf = [1, 0, 0xAA, 0xAA, 2, 0, 0xAA, 0xAA, 3, 0];
+        let mut r = StreamReader::new(NativeByteOrder::LittleEndian, &buf[..]);
+        assert_eq!(r.read_array::<u16>(Size::Bits32, 3).unwrap(), vec![1, 2, 3]);
+        assert_eq!(r.cursor_bits(), buf.len() * 8);
     }
 }
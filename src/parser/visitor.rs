@@ -0,0 +1,45 @@
+use crate::types::{EventSchema, FieldSchema, PacketContext, PacketHeader, Timestamp};
+
+/// Callbacks driven by [`Parser::visit`](crate::Parser::visit), in stream order.
+///
+/// Field values are handed over as they're decoded, no [`Packet`](crate::types::Packet)
+/// or [`Event`](crate::types::Event) is built. String values borrow from the
+/// packet buffer.
+/// Array elements are visited one by one between [`EventVisitor::on_array_begin`]
+/// and [`EventVisitor::on_array_end`].
+///
+/// All methods default to doing nothing.
+#[allow(unused_variables)]
+pub trait EventVisitor {
+    fn on_packet_header(&mut self, header: &PacketHeader) {}
+
+    fn on_packet_context(&mut self, context: &PacketContext) {}
+
+    /// Called before the event's common context, specific context and payload
+    /// members, in that order.
+    fn on_event_begin(&mut self, schema: &EventSchema, timestamp: Timestamp) {}
+
+    fn on_u64(&mut self, member: &FieldSchema, v: u64) {}
+
+    fn on_i64(&mut self, member: &FieldSchema, v: i64) {}
+
+    /// Real values, 32-bit ones are widened
+    fn on_f64(&mut self, member: &FieldSchema, v: f64) {}
+
+    /// Enumeration values, see [`FieldSchema::label`]
+    fn on_enum(&mut self, member: &FieldSchema, v: i64) {}
+
+    fn on_str(&mut self, member: &FieldSchema, v: &str) {}
+
+    fn on_array_begin(&mut self, member: &FieldSchema, len: usize) {}
+
+    fn on_array_end(&mut self, member: &FieldSchema) {}
+
+    fn on_event_end(&mut self) {}
+
+    /// Called after [`EventVisitor::on_event_end`] with the event's size in bits,
+    /// including the alignment padding ahead of its header
+    fn on_event_size(&mut self, bits: usize) {}
+
+    fn on_packet_end(&mut self) {}
+}
@@ -0,0 +1,561 @@
+use super::{
+    types::{FieldTypeParser, PrimitiveFieldTypeParser, Size, StreamParser, UIntParser},
+    Parser,
+};
+use crate::{
+    config::{Config, NativeByteOrder},
+    error::Error,
+    types::{
+        ArrayFieldValue, EventCount, EventId, FieldValue, PacketHeader, PrimitiveFieldValue,
+        StreamId, Timestamp,
+    },
+};
+use fxhash::FxHashMap;
+use std::{io::Write, ops::Range, sync::Arc};
+
+/// Encodes events into barectf CTF packets, the inverse of the [`Parser`].
+///
+/// Like the barectf tracer, events are appended to an open packet of a fixed
+/// size per stream, and packets are written out as they fill up.
+/// Packets still open are written out by [`PacketWriter::flush`] and
+/// [`PacketWriter::into_inner`], not when the writer is dropped.
+///
+/// Event timestamps are full 64-bit timestamps, truncated to the event header
+/// timestamp field type. For narrower field types, consecutive events of a stream
+/// must be less than one rollover apart to be reconstructed by the [`Parser`].
+#[derive(Debug)]
+pub struct PacketWriter<W: Write> {
+    parser: Parser,
+    packet_size: usize,
+    streams: FxHashMap<StreamId, StreamState>,
+    out: W,
+}
+
+/// Per-stream writer state
+#[derive(Debug, Default)]
+struct StreamState {
+    /// The open packet, empty when there's none
+    packet: Vec<u8>,
+    /// Byte offset of the first event in the open packet
+    events_offset: usize,
+    /// Byte offsets of the packet context fields filled in when the packet is closed
+    packet_size_offset: usize,
+    content_size_offset: usize,
+    end_timestamp_offset: Option<usize>,
+    events_discarded_offset: Option<usize>,
+    last_timestamp: Timestamp,
+    sequence_number: u64,
+    events_discarded: EventCount,
+    extra_members: Option<Vec<FieldValue>>,
+}
+
+impl<W: Write> PacketWriter<W> {
+    /// Write packets of `packet_size` bytes to `out`, for the trace described by `cfg`.
+    ///
+    /// Fails with [`Error::InvalidPacketSize`] when the size in bits doesn't fit in
+    /// the packet size and content size fields of every stream.
+    pub fn new(cfg: &Config, packet_size: usize, out: W) -> Result<Self, Error> {
+        let parser = Parser::new(cfg)?;
+        let bits = packet_size.saturating_mul(8);
+        for stream in parser.streams.values() {
+            let ctx = &stream.packet_context;
+            if bits as u64 > ctx.packet_size.desc().size.max_value()
+                || bits as u64 > ctx.content_size.desc().size.max_value()
+            {
+                return Err(Error::InvalidPacketSize(bits, bits));
+            }
+        }
+        Ok(Self {
+            parser,
+            packet_size,
+            streams: FxHashMap::default(),
+            out,
+        })
+    }
+
+    /// A parser for the packets written
+    pub fn parser(&self) -> &Parser {
+        &self.parser
+    }
+
+    /// Set the values of a stream's packet context extra members, see
+    /// [`PacketContext::extra_members`](crate::types::PacketContext::extra_members).
+    /// They default to synthetic values, see [`PacketWriter::synthetic_values`].
+    pub fn set_extra_members(
+        &mut self,
+        stream_id: StreamId,
+        values: Vec<FieldValue>,
+    ) -> Result<(), Error> {
+        let stream = stream(&self.parser, stream_id)?;
+        if values.len() != stream.packet_context.extra_members.len() {
+            return Err(Error::MismatchedFieldValue(format!(
+                "{}.packet-context-field-type-extra-members",
+                stream.stream_name
+            )));
+        }
+        self.streams.entry(stream_id).or_default().extra_members = Some(values);
+        Ok(())
+    }
+
+    /// Count events as discarded, reflected in the discarded event records counter
+    /// snapshot of the stream's open or next packet
+    pub fn discard_events(&mut self, stream_id: StreamId, count: EventCount) -> Result<(), Error> {
+        stream(&self.parser, stream_id)?;
+        let state = self.streams.entry(stream_id).or_default();
+        state.events_discarded = state.events_discarded.wrapping_add(count);
+        Ok(())
+    }
+
+    /// Append an event, with its common context, specific context and payload
+    /// member values in [`EventSchema`](crate::types::EventSchema) order.
+    /// Values that don't match their member's field type, don't fit in it, or are
+    /// strings holding a NUL are rejected as [`Error::MismatchedFieldValue`].
+    pub fn write_event(
+        &mut self,
+        stream_id: StreamId,
+        event_id: EventId,
+        timestamp: Timestamp,
+        values: &[FieldValue],
+    ) -> Result<(), Error> {
+        let stream = stream(&self.parser, stream_id)?;
+        let event = stream
+            .events
+            .get(&event_id)
+            .ok_or(Error::UndefinedEventId(event_id))?;
+        if values.len() != event.schema.len() {
+            return Err(Error::MismatchedFieldValue(event.schema.name().to_string()));
+        }
+
+        let state = self.streams.entry(stream_id).or_default();
+        if state.packet.is_empty() {
+            open_packet(
+                &self.parser,
+                self.packet_size,
+                stream_id,
+                stream,
+                state,
+                timestamp,
+            )?;
+        }
+
+        loop {
+            let event_start = state.packet.len();
+            let mut enc = Encoder {
+                buf: &mut state.packet,
+                byte_order: self.parser.byte_order,
+            };
+
+            // Event header
+            enc.align_to(stream.event_header.alignment);
+            enc.uint(&stream.event_header.event_id, event_id);
+            enc.uint(&stream.event_header.timestamp, timestamp);
+
+            // Common context, specific context then payload
+            let mut values = values.iter();
+            for p in [
+                stream.common_context.as_ref(),
+                event.specific_context.as_ref(),
+                event.payload.as_ref(),
+            ]
+            .into_iter()
+            .flatten()
+            {
+                enc.align_to(p.alignment);
+                for member in p.members.iter() {
+                    // SAFETY: the number of values was checked above
+                    let value = values.next().unwrap();
+                    if enc.field(&member.value, value).is_none() {
+                        state.packet.truncate(event_start);
+                        return Err(Error::MismatchedFieldValue(member.schema.name.to_string()));
+                    }
+                }
+            }
+
+            if state.packet.len() <= self.packet_size {
+                state.last_timestamp = timestamp;
+                return Ok(());
+            }
+
+            // Doesn't fit, retry in a new packet unless it's the only event
+            let event_size = state.packet.len() - event_start;
+            state.packet.truncate(event_start);
+            if event_start == state.events_offset {
+                return Err(Error::EventTooLarge(event_size, self.packet_size));
+            }
+            close_packet(&self.parser, self.packet_size, stream, state, &mut self.out)?;
+            open_packet(
+                &self.parser,
+                self.packet_size,
+                stream_id,
+                stream,
+                state,
+                timestamp,
+            )?;
+        }
+    }
+
+    /// Write out the open packets, then flush the underlying writer
+    pub fn flush(&mut self) -> Result<(), Error> {
+        let mut stream_ids: Vec<StreamId> = self.streams.keys().copied().collect();
+        stream_ids.sort_unstable();
+        for stream_id in stream_ids {
+            let stream = stream(&self.parser, stream_id)?;
+            // SAFETY: from the keys
+            let state = self.streams.get_mut(&stream_id).unwrap();
+            if !state.packet.is_empty() {
+                close_packet(&self.parser, self.packet_size, stream, state, &mut self.out)?;
+            }
+        }
+        self.out.flush()?;
+        Ok(())
+    }
+
+    /// [`PacketWriter::flush`], then return the underlying writer
+    pub fn into_inner(mut self) -> Result<W, Error> {
+        self.flush()?;
+        Ok(self.out)
+    }
+
+    /// Deterministic placeholder values for an event's members, varying with `seed`,
+    /// for generating synthetic traces
+    pub fn synthetic_values(
+        &self,
+        stream_id: StreamId,
+        event_id: EventId,
+        seed: u64,
+    ) -> Result<Vec<FieldValue>, Error> {
+        let stream = stream(&self.parser, stream_id)?;
+        let event = stream
+            .events
+            .get(&event_id)
+            .ok_or(Error::UndefinedEventId(event_id))?;
+        Ok([
+            stream.common_context.as_ref(),
+            event.specific_context.as_ref(),
+            event.payload.as_ref(),
+        ]
+        .into_iter()
+        .flatten()
+        .flat_map(|p| p.members.iter())
+        .enumerate()
+        .map(|(i, m)| synthetic_value(&m.value, seed.wrapping_add(i as u64)))
+        .collect())
+    }
+}
+
+fn stream(parser: &Parser, stream_id: StreamId) -> Result<&StreamParser, Error> {
+    parser
+        .streams
+        .get(&stream_id)
+        .ok_or(Error::UndefinedStreamId(stream_id))
+}
+
+/// Start a packet with its header and context. The sizes, end timestamp and
+/// discarded events snapshot are filled in by [`close_packet`].
+fn open_packet(
+    parser: &Parser,
+    packet_size: usize,
+    stream_id: StreamId,
+    stream: &StreamParser,
+    state: &mut StreamState,
+    beginning_timestamp: Timestamp,
+) -> Result<(), Error> {
+    let hdr = &parser.pkt_header;
+    let ctx = &stream.packet_context;
+    let mut enc = Encoder {
+        buf: &mut state.packet,
+        byte_order: parser.byte_order,
+    };
+
+    // Packet header
+    enc.align_to(hdr.alignment);
+    if let Some(magic) = hdr.magic.as_ref() {
+        enc.uint(magic, PacketHeader::MAGIC.into());
+    }
+    if hdr.uuid.is_some() {
+        enc.buf
+            .extend_from_slice(parser.trace_uuid.unwrap_or_default().as_bytes());
+    }
+    enc.uint(&hdr.stream_id, stream_id);
+
+    // Packet context
+    enc.align_to(ctx.alignment);
+    state.packet_size_offset = enc.uint(&ctx.packet_size, 0);
+    state.content_size_offset = enc.uint(&ctx.content_size, 0);
+    if let Some(f) = ctx.beginning_timestamp.as_ref() {
+        enc.uint(f, beginning_timestamp);
+    }
+    state.end_timestamp_offset = ctx.end_timestamp.as_ref().map(|f| enc.uint(f, 0));
+    state.events_discarded_offset = ctx.events_discarded.as_ref().map(|f| enc.uint(f, 0));
+    if let Some(f) = ctx.sequence_number.as_ref() {
+        enc.uint(f, state.sequence_number);
+    }
+    let extra_members = state.extra_members.get_or_insert_with(|| {
+        ctx.extra_members
+            .iter()
+            .map(|m| synthetic_value(&m.value, 0))
+            .collect()
+    });
+    for (member, value) in ctx.extra_members.iter().zip(extra_members.iter()) {
+        if enc.field(&member.value, value).is_none() {
+            state.packet.clear();
+            return Err(Error::MismatchedFieldValue(member.schema.name.to_string()));
+        }
+    }
+
+    state.events_offset = state.packet.len();
+    state.last_timestamp = beginning_timestamp;
+    if state.events_offset > packet_size {
+        state.packet.clear();
+        return Err(Error::EventTooLarge(state.events_offset, packet_size));
+    }
+    Ok(())
+}
+
+/// Fill in the packet context, pad the packet out to its size and write it
+fn close_packet<W: Write>(
+    parser: &Parser,
+    packet_size: usize,
+    stream: &StreamParser,
+    state: &mut StreamState,
+    out: &mut W,
+) -> Result<(), Error> {
+    let ctx = &stream.packet_context;
+    let content_size_bits = state.packet.len() * 8;
+    state.packet.resize(packet_size, 0);
+
+    let mut enc = Encoder {
+        buf: &mut state.packet,
+        byte_order: parser.byte_order,
+    };
+    let sizes = enc
+        .patch_uint(
+            state.packet_size_offset,
+            &ctx.packet_size,
+            packet_size as u64 * 8,
+        )
+        .and_then(|_| {
+            enc.patch_uint(
+                state.content_size_offset,
+                &ctx.content_size,
+                content_size_bits as u64,
+            )
+        });
+    if sizes.is_none() {
+        state.packet.clear();
+        return Err(Error::InvalidPacketSize(packet_size * 8, content_size_bits));
+    }
+    // Like the event timestamps, truncated to the field type
+    if let (Some(offset), Some(f)) = (state.end_timestamp_offset, ctx.end_timestamp.as_ref()) {
+        let v = state.last_timestamp & f.desc().size.max_value();
+        enc.patch_uint(offset, f, v);
+    }
+    // A free-running counter, wraps around
+    if let (Some(offset), Some(f)) = (state.events_discarded_offset, ctx.events_discarded.as_ref())
+    {
+        let v = state.events_discarded & f.desc().size.max_value();
+        enc.patch_uint(offset, f, v);
+    }
+
+    out.write_all(&state.packet)?;
+    state.packet.clear();
+    state.sequence_number = state.sequence_number.wrapping_add(1);
+    Ok(())
+}
+
+fn synthetic_value(ft: &FieldTypeParser, seed: u64) -> FieldValue {
+    let (len, p) = match ft {
+        FieldTypeParser::Primitive(p) => return synthetic_primitive(p, seed).into(),
+        FieldTypeParser::StaticArray(len, p) => (*len, p),
+        FieldTypeParser::DynamicArray(p) => ((seed % 5) as usize, p),
+    };
+    let size = p.desc().size;
+    let v = seed & size.max_value();
+    match p {
+        PrimitiveFieldTypeParser::UInt(_) | PrimitiveFieldTypeParser::UEnum(_) => match size {
+            Size::Bits8 => ArrayFieldValue::U8(vec![v as u8; len]),
+            Size::Bits16 => ArrayFieldValue::U16(vec![v as u16; len]),
+            Size::Bits32 => ArrayFieldValue::U32(vec![v as u32; len]),
+            Size::Bits64 => ArrayFieldValue::U64(vec![v; len]),
+        },
+        PrimitiveFieldTypeParser::Int(_) | PrimitiveFieldTypeParser::Enum(_) => match size {
+            Size::Bits8 => ArrayFieldValue::I8(vec![v as i8; len]),
+            Size::Bits16 => ArrayFieldValue::I16(vec![v as i16; len]),
+            Size::Bits32 => ArrayFieldValue::I32(vec![v as i32; len]),
+            Size::Bits64 => ArrayFieldValue::I64(vec![v as i64; len]),
+        },
+        PrimitiveFieldTypeParser::Real(_) if size == Size::Bits32 => {
+            ArrayFieldValue::F32(vec![(v as f32).into(); len])
+        }
+        PrimitiveFieldTypeParser::Real(_) => ArrayFieldValue::F64(vec![(v as f64).into(); len]),
+        PrimitiveFieldTypeParser::String(_) => {
+            ArrayFieldValue::String(vec![synthetic_str(seed); len])
+        }
+    }
+    .into()
+}
+
+fn synthetic_primitive(p: &PrimitiveFieldTypeParser, seed: u64) -> PrimitiveFieldValue {
+    let size = p.desc().size;
+    let v = seed & size.max_value();
+    match p {
+        PrimitiveFieldTypeParser::UInt(_) => PrimitiveFieldValue::UnsignedInteger(v),
+        // Sign-extended from the field type size
+        PrimitiveFieldTypeParser::Int(_) => {
+            let shift = 64 - size.bytes() * 8;
+            PrimitiveFieldValue::SignedInteger(((v << shift) as i64) >> shift)
+        }
+        PrimitiveFieldTypeParser::UEnum(_) | PrimitiveFieldTypeParser::Enum(_) => {
+            PrimitiveFieldValue::Enumeration((seed % 4) as i64)
+        }
+        PrimitiveFieldTypeParser::Real(_) if size == Size::Bits32 => {
+            PrimitiveFieldValue::F32((v as f32).into())
+        }
+        PrimitiveFieldTypeParser::Real(_) => PrimitiveFieldValue::F64((v as f64).into()),
+        PrimitiveFieldTypeParser::String(_) => PrimitiveFieldValue::String(synthetic_str(seed)),
+    }
+}
+
+fn synthetic_str(seed: u64) -> Arc<str> {
+    const WORDS: [&str; 4] = ["idle", "sensor", "task_switch", "timer"];
+    WORDS[(seed % WORDS.len() as u64) as usize].into()
+}
+
+/// `v` if it fits in an unsigned field of `size`
+fn unsigned_bits(size: Size, v: u64) -> Option<u64> {
+    (v <= size.max_value()).then_some(v)
+}
+
+/// The two's complement bits of `v` if it fits in a signed field of `size`
+fn signed_bits(size: Size, v: i64) -> Option<u64> {
+    let shift = 64 - size.bits();
+    (((v << shift) >> shift) == v).then_some(v as u64)
+}
+
+/// Appends fields to a packet buffer, aligned relative to the packet start
+struct Encoder<'a> {
+    buf: &'a mut Vec<u8>,
+    byte_order: NativeByteOrder,
+}
+
+impl Encoder<'_> {
+    fn align_to(&mut self, align: Size) {
+        let len = self.buf.len().next_multiple_of(align.bytes());
+        self.buf.resize(len, 0);
+    }
+
+    /// The low `size` bytes of `v`, in the stream byte order
+    fn to_bytes(&self, size: Size, v: u64) -> ([u8; 8], Range<usize>) {
+        let n = size.bytes();
+        match self.byte_order {
+            NativeByteOrder::LittleEndian => (v.to_le_bytes(), 0..n),
+            NativeByteOrder::BigEndian => (v.to_be_bytes(), 8 - n..8),
+        }
+    }
+
+    fn put(&mut self, size: Size, v: u64) {
+        let (bytes, range) = self.to_bytes(size, v);
+        self.buf.extend_from_slice(&bytes[range]);
+    }
+
+    /// Returns the field's byte offset
+    fn uint(&mut self, f: &UIntParser, v: u64) -> usize {
+        self.align_to(f.desc().alignment);
+        let offset = self.buf.len();
+        self.put(f.desc().size, v);
+        offset
+    }
+
+    /// Overwrite a field written by [`Encoder::uint`].
+    /// Returns `None`, leaving the field as-is, when `v` doesn't fit in it.
+    fn patch_uint(&mut self, offset: usize, f: &UIntParser, v: u64) -> Option<()> {
+        let size = f.desc().size;
+        if v > size.max_value() {
+            return None;
+        }
+        let (bytes, range) = self.to_bytes(size, v);
+        self.buf[offset..offset + range.len()].copy_from_slice(&bytes[range]);
+        Some(())
+    }
+
+    /// Returns `None` when `s` holds a NUL, which would end it early when decoded
+    fn str(&mut self, s: &str) -> Option<()> {
+        if memchr::memchr(0, s.as_bytes()).is_some() {
+            return None;
+        }
+        self.buf.extend_from_slice(s.as_bytes());
+        self.buf.push(0);
+        Some(())
+    }
+
+    /// Returns `None` when the value doesn't match the field type, or is out of its range
+    fn primitive(&mut self, p: &PrimitiveFieldTypeParser, v: &PrimitiveFieldValue) -> Option<()> {
+        use PrimitiveFieldTypeParser as P;
+        use PrimitiveFieldValue as V;
+
+        let desc = p.desc();
+        self.align_to(desc.alignment);
+        let bits = match (p, v) {
+            (P::UInt(_), V::UnsignedInteger(v)) => unsigned_bits(desc.size, *v)?,
+            (P::Int(_), V::SignedInteger(v)) => signed_bits(desc.size, *v)?,
+            // NOTE: unsigned enums are decoded as i64, the 64 bit ones wrapping
+            (P::UEnum(_), V::Enumeration(v)) => unsigned_bits(desc.size, *v as u64)?,
+            (P::Enum(_), V::Enumeration(v)) => signed_bits(desc.size, *v)?,
+            (P::Real(_), V::F32(v)) if desc.size == Size::Bits32 => v.0.to_bits().into(),
+            (P::Real(_), V::F64(v)) if desc.size == Size::Bits64 => v.0.to_bits(),
+            (P::String(_), V::String(s)) => return self.str(s),
+            _ => return None,
+        };
+        self.put(desc.size, bits);
+        Some(())
+    }
+
+    /// Returns `None` when the value doesn't match the element type
+    fn elements(&mut self, p: &PrimitiveFieldTypeParser, v: &ArrayFieldValue) -> Option<()> {
+        use ArrayFieldValue as A;
+        use PrimitiveFieldTypeParser as P;
+
+        let desc = *p.desc();
+        macro_rules! put_all {
+            ($a:expr, $x:ident => $bits:expr) => {{
+                for &$x in $a.iter() {
+                    self.align_to(desc.alignment);
+                    self.put(desc.size, $bits);
+                }
+            }};
+        }
+        match (p, desc.size, v) {
+            (P::UInt(_) | P::UEnum(_), Size::Bits8, A::U8(a)) => put_all!(a, x => x.into()),
+            (P::UInt(_) | P::UEnum(_), Size::Bits16, A::U16(a)) => put_all!(a, x => x.into()),
+            (P::UInt(_) | P::UEnum(_), Size::Bits32, A::U32(a)) => put_all!(a, x => x.into()),
+            (P::UInt(_) | P::UEnum(_), Size::Bits64, A::U64(a)) => put_all!(a, x => x),
+            (P::Int(_) | P::Enum(_), Size::Bits8, A::I8(a)) => put_all!(a, x => x as u64),
+            (P::Int(_) | P::Enum(_), Size::Bits16, A::I16(a)) => put_all!(a, x => x as u64),
+            (P::Int(_) | P::Enum(_), Size::Bits32, A::I32(a)) => put_all!(a, x => x as u64),
+            (P::Int(_) | P::Enum(_), Size::Bits64, A::I64(a)) => put_all!(a, x => x as u64),
+            (P::Real(_), Size::Bits32, A::F32(a)) => put_all!(a, x => x.0.to_bits().into()),
+            (P::Real(_), Size::Bits64, A::F64(a)) => put_all!(a, x => x.0.to_bits()),
+            (P::String(_), _, A::String(a)) => a.iter().try_for_each(|s| self.str(s))?,
+            _ => return None,
+        }
+        Some(())
+    }
+
+    /// See [`FieldTypeParser::parse`]
+    fn field(&mut self, ft: &FieldTypeParser, v: &FieldValue) -> Option<()> {
+        match (ft, v) {
+            (FieldTypeParser::Primitive(p), FieldValue::Primitive(v)) => self.primitive(p, v),
+            (FieldTypeParser::StaticArray(len, p), FieldValue::Array(a)) if a.len() == *len => {
+                self.align_to(p.desc().alignment);
+                self.elements(p, a)
+            }
+            (FieldTypeParser::DynamicArray(p), FieldValue::Array(a)) => {
+                // NOTE: the u32 len field is always byte-packed
+                self.put(Size::Bits32, u32::try_from(a.len()).ok()?.into());
+                self.align_to(p.desc().alignment);
+                self.elements(p, a)
+            }
+            _ => None,
+        }
+    }
+}
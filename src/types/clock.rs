@@ -0,0 +1,207 @@
+use crate::{config::ClockType, types::Timestamp};
+
+const NANOS_PER_SEC: u64 = 1_000_000_000;
+
+/// Converts clock cycles to nanoseconds from the clock's origin.
+///
+/// The conversion factor is precomputed as a fixed-point `mult / 2^shift`
+/// pair, so each conversion is a widening multiply and a shift rather
+/// than a 128-bit division.
+/// The shift is as large as the clock frequency allows, the conversion is
+/// exact for 1 GHz clocks and otherwise off by well under a nanosecond per
+/// second of cycles.
+#[derive(Copy, Clone, Eq, PartialEq, Hash, Debug)]
+pub struct ClockConverter {
+    mult: u64,
+    shift: u32,
+    /// The clock type offset, in nanoseconds
+    offset_ns: i64,
+    origin_is_unix_epoch: bool,
+}
+
+impl ClockConverter {
+    /// Returns `None` for a zero clock frequency
+    pub fn new(clock_type: &ClockType) -> Option<Self> {
+        if clock_type.frequency == 0 {
+            return None;
+        }
+        let freq = u128::from(clock_type.frequency);
+
+        // Largest shift keeping the multiplier in 64 bits
+        let mut shift = 64;
+        while (u128::from(NANOS_PER_SEC) << shift) / freq > u128::from(u64::MAX) {
+            shift -= 1;
+        }
+        let mult = ((u128::from(NANOS_PER_SEC) << shift) / freq) as u64;
+
+        let mut c = Self {
+            mult,
+            shift,
+            offset_ns: 0,
+            origin_is_unix_epoch: clock_type.origin_is_unix_epoch,
+        };
+        if let Some(offset) = clock_type.offset.as_ref() {
+            c.offset_ns = offset
+                .seconds
+                .saturating_mul(NANOS_PER_SEC as i64)
+                .saturating_add_unsigned(c.cycles_to_nanos(offset.cycles));
+        }
+        Some(c)
+    }
+
+    /// True if the converted nanoseconds are relative to the Unix epoch
+    pub fn origin_is_unix_epoch(&self) -> bool {
+        self.origin_is_unix_epoch
+    }
+
+    /// Convert a duration in cycles to nanoseconds, without the clock offset,
+    /// saturating at `u64::MAX`
+    #[inline]
+    pub fn cycles_to_nanos(&self, cycles: Timestamp) -> u64 {
+        let nanos = (u128::from(cycles) * u128::from(self.mult)) >> self.shift;
+        u64::try_from(nanos).unwrap_or(u64::MAX)
+    }
+
+    /// Convert a timestamp to nanoseconds from the clock's origin,
+    /// including the clock offset, saturating at zero and `u64::MAX`
+    #[inline]
+    pub fn to_nanos(&self, cycles: Timestamp) -> u64 {
+        self.cycles_to_nanos(cycles)
+            .saturating_add_signed(self.offset_ns)
+    }
+
+    /// Convert a column of timestamps to nanoseconds in place, see [`ClockConverter::to_nanos`]
+    pub fn to_nanos_in_place(&self, timestamps: &mut [Timestamp]) {
+        for t in timestamps.iter_mut() {
+            *t = self.to_nanos(*t);
+        }
+    }
+
+    /// Convert a column of timestamps to nanoseconds into `out`, see [`ClockConverter::to_nanos`].
+    /// Converts `min(cycles.len(), out.len())` timestamps.
+    pub fn to_nanos_slice(&self, cycles: &[Timestamp], out: &mut [u64]) {
+        for (o, c) in out.iter_mut().zip(cycles) {
+            *o = self.to_nanos(*c);
+        }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use crate::config::ClockTypeOffset;
+
+    fn clock_type(frequency: u64, offset: Option<ClockTypeOffset>) -> ClockType {
+        ClockType {
+            frequency,
+            offset,
+            origin_is_unix_epoch: true,
+            precision: 1,
+            uuid: None,
+            description: None,
+            c_type: "uint64_t".to_owned(),
+        }
+    }
+
+    /// Reference conversion through a 128-bit division
+    fn reference(frequency: u64, cycles: u64) -> Option<u64> {
+        (u128::from(cycles) * u128::from(NANOS_PER_SEC) / u128::from(frequency))
+            .try_into()
+            .ok()
+    }
+
+    #[test]
+    fn clock_conversion_matches_division() {
+        for frequency in [
+            1,
+            3,
+            32_768,
+            1_000_000,
+            16_000_000,
+            999_999_937,
+            1_000_000_000,
+            3_600_000_000,
+            u64::MAX,
+        ] {
+            let c = ClockConverter::new(&clock_type(frequency, None)).unwrap();
+            for cycles in [
+                0,
+                1,
+                7,
+                1_000,
+                123_456_789,
+                1 << 40,
+                1 << 52,
+                frequency,
+                u64::MAX / NANOS_PER_SEC,
+            ] {
+                let Some(expected) = reference(frequency, cycles) else {
+                    // Out of range
+                    continue;
+                };
+                let actual = c.to_nanos(cycles);
+                // Off by at most 1 ns per second of cycles, plus rounding
+                let tolerance = 1 + expected / NANOS_PER_SEC;
+                assert!(
+                    expected.abs_diff(actual) <= tolerance,
+                    "{frequency} Hz, {cycles} cycles: {actual} != {expected}"
+                );
+            }
+        }
+
+        // Exact at 1 GHz
+        let c = ClockConverter::new(&clock_type(NANOS_PER_SEC, None)).unwrap();
+        assert_eq!(c.to_nanos(u64::MAX), u64::MAX);
+    }
+
+    #[test]
+    fn clock_conversion_offset() {
+        let offset = ClockTypeOffset {
+            seconds: 10,
+            cycles: 500,
+        };
+        let c = ClockConverter::new(&clock_type(1_000, Some(offset))).unwrap();
+        assert_eq!(c.to_nanos(0), 10_500_000_000);
+        assert_eq!(c.to_nanos(1), 10_501_000_000);
+
+        let mut column = [0, 1, 2];
+        c.to_nanos_in_place(&mut column);
+        assert_eq!(column, [10_500_000_000, 10_501_000_000, 10_502_000_000]);
+
+        let offset = ClockTypeOffset {
+            seconds: -1,
+            cycles: 0,
+        };
+        let c = ClockConverter::new(&clock_type(1_000, Some(offset))).unwrap();
+        assert_eq!(c.to_nanos(0), 0);
+        assert_eq!(c.to_nanos(2_000), 1_000_000_000);
+        let mut out = [0; 2];
+        c.to_nanos_slice(&[1_000, 3_000], &mut out);
+        assert_eq!(out, [0, 2_000_000_000]);
+    }
+
+    #[test]
+    fn clock_conversion_saturates() {
+        // 1 kHz, way past u64::MAX nanoseconds
+        let c = ClockConverter::new(&clock_type(1_000, None)).unwrap();
+        assert_eq!(c.cycles_to_nanos(Timestamp::MAX), u64::MAX);
+        assert_eq!(c.to_nanos(Timestamp::MAX), u64::MAX);
+        assert_eq!(
+            c.to_nanos(u64::MAX / 1_000_000),
+            u64::MAX / 1_000_000 * 1_000_000
+        );
+
+        let offset = ClockTypeOffset {
+            seconds: 1,
+            cycles: Timestamp::MAX,
+        };
+        let c = ClockConverter::new(&clock_type(1, Some(offset))).unwrap();
+        assert_eq!(c.to_nanos(0), i64::MAX as u64);
+        assert_eq!(c.to_nanos(Timestamp::MAX), u64::MAX);
+    }
+
+    #[test]
+    fn zero_frequency_clock() {
+        assert_eq!(ClockConverter::new(&clock_type(0, None)), None);
+    }
+}
@@ -0,0 +1,230 @@
+use crate::{error::Error, types::PacketContext};
+use serde::{Deserialize, Serialize};
+use std::{
+    fmt::Write,
+    io,
+    sync::atomic::{AtomicU64, Ordering},
+};
+
+/// Parser-wide decode totals, see [`Parser::counters`](crate::Parser::counters).
+///
+/// Updated once per decoded packet or decoding error, from every decoding path
+/// including [`Parser::parse_parallel`](crate::Parser::parse_parallel).
+#[derive(Copy, Clone, Eq, PartialEq, Hash, Debug, Default, Serialize, Deserialize)]
+pub struct DecodeCounters {
+    /// Packets decoded
+    pub packets: u64,
+    /// Events decoded
+    pub events: u64,
+    /// Bytes of the decoded packets, including their padding
+    pub bytes: u64,
+    /// Padding bytes following the content of the decoded packets
+    pub padding_bytes: u64,
+    /// Bytes dropped while resynchronizing, see
+    /// [`PacketDecoder::with_resync`](crate::PacketDecoder::with_resync)
+    pub skipped_bytes: u64,
+    /// Decoding errors, by kind
+    pub errors: DecodeErrorCounters,
+}
+
+/// Decoding error totals, by kind
+#[derive(Copy, Clone, Eq, PartialEq, Hash, Debug, Default, Serialize, Deserialize)]
+pub struct DecodeErrorCounters {
+    /// Stream IDs not defined in the schema
+    pub undefined_stream_id: u64,
+    /// Event IDs not defined in the schema
+    pub undefined_event_id: u64,
+    /// Wrong magic numbers or trace UUIDs, inconsistent packet sizes
+    pub invalid_packet: u64,
+    /// Input ending mid-packet, the end of the input on a packet boundary isn't counted
+    pub unexpected_eof: u64,
+    /// Other IO errors
+    pub io: u64,
+    /// Everything else
+    pub other: u64,
+}
+
+impl DecodeErrorCounters {
+    fn iter(&self) -> [(&'static str, u64); 6] {
+        [
+            ("undefined_stream_id", self.undefined_stream_id),
+            ("undefined_event_id", self.undefined_event_id),
+            ("invalid_packet", self.invalid_packet),
+            ("unexpected_eof", self.unexpected_eof),
+            ("io", self.io),
+            ("other", self.other),
+        ]
+    }
+}
+
+impl DecodeCounters {
+    /// Render the counters in the Prometheus text exposition format, with `labels`
+    /// added to every sample, e.g. to tell several decoders apart.
+    pub fn prometheus_text(&self, labels: &[(&str, &str)]) -> String {
+        let mut base = String::new();
+        for (i, (k, v)) in labels.iter().enumerate() {
+            if i != 0 {
+                base.push(',');
+            }
+            // SAFETY: writing to a String can't fail
+            write!(base, "{k}=\"{}\"", escape_label_value(v)).unwrap();
+        }
+
+        let mut out = String::new();
+        let mut counter = |name: &str, help: &str, samples: &[(Option<&str>, u64)]| {
+            // SAFETY: writing to a String can't fail
+            writeln!(out, "# HELP barectf_{name} {help}").unwrap();
+            writeln!(out, "# TYPE barectf_{name} counter").unwrap();
+            for (kind, v) in samples {
+                let labels = match kind {
+                    Some(kind) if base.is_empty() => format!("{{kind=\"{kind}\"}}"),
+                    Some(kind) => format!("{{{base},kind=\"{kind}\"}}"),
+                    None if base.is_empty() => String::new(),
+                    None => format!("{{{base}}}"),
+                };
+                writeln!(out, "barectf_{name}{labels} {v}").unwrap();
+            }
+        };
+
+        counter("packets_total", "Packets decoded", &[(None, self.packets)]);
+        counter("events_total", "Events decoded", &[(None, self.events)]);
+        counter(
+            "bytes_total",
+            "Bytes of the decoded packets",
+            &[(None, self.bytes)],
+        );
+        counter(
+            "padding_bytes_total",
+            "Padding bytes following the content of the decoded packets",
+            &[(None, self.padding_bytes)],
+        );
+        counter(
+            "skipped_bytes_total",
+            "Bytes dropped while resynchronizing",
+            &[(None, self.skipped_bytes)],
+        );
+        let errors: Vec<_> = self
+            .errors
+            .iter()
+            .into_iter()
+            .map(|(kind, v)| (Some(kind), v))
+            .collect();
+        counter("decode_errors_total", "Decoding errors", &errors);
+        out
+    }
+}
+
+fn escape_label_value(v: &str) -> String {
+    v.replace('\\', "\\\\")
+        .replace('"', "\\\"")
+        .replace('\n', "\\n")
+}
+
+/// Lock-free [`DecodeCounters`], shared by the decoding threads
+#[derive(Debug, Default)]
+pub(crate) struct AtomicDecodeCounters {
+    packets: AtomicU64,
+    events: AtomicU64,
+    bytes: AtomicU64,
+    padding_bytes: AtomicU64,
+    skipped_bytes: AtomicU64,
+    undefined_stream_id: AtomicU64,
+    undefined_event_id: AtomicU64,
+    invalid_packet: AtomicU64,
+    unexpected_eof: AtomicU64,
+    io: AtomicU64,
+    other: AtomicU64,
+}
+
+impl AtomicDecodeCounters {
+    pub fn snapshot(&self) -> DecodeCounters {
+        let get = |c: &AtomicU64| c.load(Ordering::Relaxed);
+        DecodeCounters {
+            packets: get(&self.packets),
+            events: get(&self.events),
+            bytes: get(&self.bytes),
+            padding_bytes: get(&self.padding_bytes),
+            skipped_bytes: get(&self.skipped_bytes),
+            errors: DecodeErrorCounters {
+                undefined_stream_id: get(&self.undefined_stream_id),
+                undefined_event_id: get(&self.undefined_event_id),
+                invalid_packet: get(&self.invalid_packet),
+                unexpected_eof: get(&self.unexpected_eof),
+                io: get(&self.io),
+                other: get(&self.other),
+            },
+        }
+    }
+
+    pub fn skipped_bytes(&self) -> u64 {
+        self.skipped_bytes.load(Ordering::Relaxed)
+    }
+
+    pub fn record_packet(&self, context: &PacketContext, events: usize) {
+        self.packets.fetch_add(1, Ordering::Relaxed);
+        self.events.fetch_add(events as u64, Ordering::Relaxed);
+        self.bytes
+            .fetch_add(context.packet_size() as u64, Ordering::Relaxed);
+        let padding_bits = context
+            .packet_size_bits
+            .saturating_sub(context.content_size_bits);
+        self.padding_bytes
+            .fetch_add((padding_bits >> 3) as u64, Ordering::Relaxed);
+    }
+
+    pub fn record_skipped(&self, bytes: usize) {
+        self.skipped_bytes
+            .fetch_add(bytes as u64, Ordering::Relaxed);
+    }
+
+    pub fn record_error(&self, e: &Error) {
+        let c = match e {
+            Error::UndefinedStreamId(_) => &self.undefined_stream_id,
+            Error::UndefinedEventId(_) => &self.undefined_event_id,
+            Error::InvalidMagicNumber(_)
+            | Error::TraceUuidMismatch(_)
+            | Error::InvalidPacketSize(_, _) => &self.invalid_packet,
+            Error::Io(e) if e.kind() == io::ErrorKind::UnexpectedEof => &self.unexpected_eof,
+            Error::Io(_) => &self.io,
+            _ => &self.other,
+        };
+        c.fetch_add(1, Ordering::Relaxed);
+    }
+
+    /// Pass `res` through, counting its error if any
+    pub fn count<T>(&self, res: Result<T, Error>) -> Result<T, Error> {
+        if let Err(e) = &res {
+            self.record_error(e);
+        }
+        res
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    #[test]
+    fn prometheus_text_exposition() {
+        let counters = AtomicDecodeCounters::default();
+        counters.record_error(&Error::UndefinedEventId(3));
+        counters.record_error(&Error::InvalidMagicNumber(0));
+        counters.record_skipped(5);
+        let text = counters
+            .snapshot()
+            .prometheus_text(&[("stream", "a \"b\"")]);
+        assert!(text.contains("# TYPE barectf_packets_total counter\n"));
+        assert!(text.contains("barectf_packets_total{stream=\"a \\\"b\\\"\"} 0\n"));
+        assert!(text.contains("barectf_skipped_bytes_total{stream=\"a \\\"b\\\"\"} 5\n"));
+        assert!(text.contains(
+            "barectf_decode_errors_total{stream=\"a \\\"b\\\"\",kind=\"undefined_event_id\"} 1\n"
+        ));
+        assert!(text.contains(
+            "barectf_decode_errors_total{stream=\"a \\\"b\\\"\",kind=\"invalid_packet\"} 1\n"
+        ));
+
+        let text = counters.snapshot().prometheus_text(&[]);
+        assert!(text.contains("barectf_events_total 0\n"));
+        assert!(text.contains("barectf_decode_errors_total{kind=\"other\"} 0\n"));
+    }
+}
@@ -1,14 +1,134 @@
-use crate::types::{EventId, FieldValue, LogLevel, Timestamp};
+use crate::types::{
+    schema::{Members, NamedMembers},
+    EventId, EventSchema, FieldSchema, FieldValue, LogLevel, Timestamp,
+};
 use internment::Intern;
-use serde::{Deserialize, Serialize};
+use serde::{ser::SerializeStruct, Deserialize, Serialize, Serializer};
+use std::{fmt, ops::Range};
 
-#[derive(Clone, PartialEq, Debug, Serialize, Deserialize)]
+/// A decoded event.
+/// The member values are positional, see [`EventSchema`] for their layout.
+///
+/// Serialized with its schema's ID, name and log level, and its members as
+/// sections of `(name, value)` pairs rather than a copy of the whole schema.
+#[derive(Clone, PartialEq, Deserialize)]
+#[serde(from = "EventFields")]
 pub struct Event {
-    pub id: EventId,
-    pub name: Intern<String>,
+    pub schema: Intern<EventSchema>,
+    /// Full 64-bit timestamp (cycles), reconstructed across rollovers of
+    /// narrower timestamp field types
     pub timestamp: Timestamp,
-    pub log_level: Option<LogLevel>,
-    pub common_context: Vec<(Intern<String>, FieldValue)>,
-    pub specific_context: Vec<(Intern<String>, FieldValue)>,
-    pub payload: Vec<(Intern<String>, FieldValue)>,
+    pub values: Vec<FieldValue>,
+}
+
+impl Event {
+    pub fn id(&self) -> EventId {
+        self.schema.id()
+    }
+
+    pub fn name(&self) -> Intern<String> {
+        self.schema.name()
+    }
+
+    pub fn log_level(&self) -> Option<LogLevel> {
+        self.schema.log_level()
+    }
+
+    pub fn common_context(&self) -> impl Iterator<Item = (&FieldSchema, &FieldValue)> {
+        self.members(self.schema.common_context())
+    }
+
+    pub fn specific_context(&self) -> impl Iterator<Item = (&FieldSchema, &FieldValue)> {
+        self.members(self.schema.specific_context())
+    }
+
+    pub fn payload(&self) -> impl Iterator<Item = (&FieldSchema, &FieldValue)> {
+        self.members(self.schema.payload())
+    }
+
+    /// Return the value of a member by name, see [`EventSchema::position`]
+    pub fn get(&self, name: &str) -> Option<&FieldValue> {
+        self.values.get(self.schema.position(name)?)
+    }
+
+    fn members(&self, r: Range<usize>) -> impl Iterator<Item = (&FieldSchema, &FieldValue)> {
+        self.schema.members()[r.clone()]
+            .iter()
+            .map(|s| s.as_ref())
+            .zip(&self.values[r])
+    }
+}
+
+impl Serialize for Event {
+    fn serialize<S: Serializer>(&self, s: S) -> Result<S::Ok, S::Error> {
+        let section =
+            |r: Range<usize>| NamedMembers(&self.schema.members()[r.clone()], &self.values[r]);
+        let mut st = s.serialize_struct("Event", 7)?;
+        st.serialize_field("id", &self.id())?;
+        st.serialize_field("name", &self.name())?;
+        st.serialize_field("timestamp", &self.timestamp)?;
+        st.serialize_field("log_level", &self.log_level())?;
+        st.serialize_field("common_context", &section(self.schema.common_context()))?;
+        st.serialize_field("specific_context", &section(self.schema.specific_context()))?;
+        st.serialize_field("payload", &section(self.schema.payload()))?;
+        st.end()
+    }
+}
+
+/// The serialized form of an [`Event`], the schema is rebuilt from the member names
+#[derive(Deserialize)]
+struct EventFields {
+    id: EventId,
+    name: Intern<String>,
+    timestamp: Timestamp,
+    log_level: Option<LogLevel>,
+    #[serde(deserialize_with = "NamedMembers::deserialize_schemas")]
+    common_context: Members,
+    #[serde(deserialize_with = "NamedMembers::deserialize_schemas")]
+    specific_context: Members,
+    #[serde(deserialize_with = "NamedMembers::deserialize_schemas")]
+    payload: Members,
+}
+
+impl From<EventFields> for Event {
+    fn from(f: EventFields) -> Self {
+        let schema = EventSchema::new(
+            f.id,
+            &f.name,
+            f.log_level,
+            &f.common_context.0,
+            &f.specific_context.0,
+            &f.payload.0,
+        );
+        Self {
+            schema: Intern::new(schema),
+            timestamp: f.timestamp,
+            values: [f.common_context.1, f.specific_context.1, f.payload.1].concat(),
+        }
+    }
+}
+
+impl fmt::Debug for Event {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        // Members by name rather than dumping the whole schema for each event
+        struct Members<'a>(&'a [Intern<FieldSchema>], &'a [FieldValue]);
+        impl fmt::Debug for Members<'_> {
+            fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+                f.debug_map()
+                    .entries(self.0.iter().map(|s| s.name.as_str()).zip(self.1))
+                    .finish()
+            }
+        }
+        let section = |r: Range<usize>| Members(&self.schema.members()[r.clone()], &self.values[r]);
+
+        f.debug_struct("Event")
+            .field("id", &self.id())
+            .field("name", &self.name())
+            .field("timestamp", &self.timestamp)
+            .field("log_level", &self.log_level())
+            .field("common_context", &section(self.schema.common_context()))
+            .field("specific_context", &section(self.schema.specific_context()))
+            .field("payload", &section(self.schema.payload()))
+            .finish()
+    }
 }
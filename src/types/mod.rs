@@ -1,15 +1,25 @@
-use crate::config::{PreferredDisplayBase, UnsignedIntegerFieldType};
+use crate::config::UnsignedIntegerFieldType;
 use derive_more::Display;
-use internment::Intern;
 use num_enum::{FromPrimitive, IntoPrimitive};
 use ordered_float::OrderedFloat;
 use serde::{Deserialize, Serialize};
+use std::sync::Arc;
 
+pub use clock::ClockConverter;
+pub use counters::{DecodeCounters, DecodeErrorCounters};
 pub use event::Event;
 pub use packet::{Packet, PacketContext, PacketHeader};
+pub use profile::EventProfile;
+pub use schema::{EnumerationMappings, EventSchema, FieldSchema};
+pub use stats::StreamStats;
 
+pub mod clock;
+pub mod counters;
 pub mod event;
 pub mod packet;
+pub mod profile;
+pub mod schema;
+pub mod stats;
 
 pub type StreamId = u64;
 
@@ -150,7 +160,7 @@ pub struct UnsupportedTimestampFieldType {}
 #[derive(Clone, Eq, PartialEq, Ord, PartialOrd, Hash, Debug)]
 pub struct TrackingInstant {
     lower: CyclesTracker,
-    upper: u32,
+    upper: u64,
 }
 
 impl TrackingInstant {
@@ -174,7 +184,18 @@ impl TrackingInstant {
 
     pub fn reset_to(&mut self, cycles: Timestamp, upper: u32) {
         self.lower.set(cycles);
-        self.upper = upper;
+        self.upper = upper.into();
+    }
+
+    /// Reset to a full 64-bit timestamp, e.g. a packet's beginning timestamp,
+    /// subsequent cycles are then relative to it
+    pub fn reset_to_timestamp(&mut self, timestamp: Timestamp) {
+        self.lower.set(timestamp);
+        self.upper = if self.lower.is_u64() {
+            0
+        } else {
+            timestamp >> self.lower.size_bits()
+        };
     }
 
     pub fn elapsed(&mut self, cycles: Timestamp) -> Timestamp {
@@ -196,25 +217,87 @@ impl TrackingInstant {
         if self.lower.is_u64() {
             self.lower.as_cycles()
         } else {
-            (u64::from(self.upper) << self.lower.size_bits()) | self.lower.as_cycles()
+            (self.upper << self.lower.size_bits()) | self.lower.as_cycles()
         }
     }
 }
 
+/// A decoded primitive value.
+///
+/// Kept compact, the preferred display base and enumeration labels are
+/// looked up on demand from the member's [`FieldSchema`].
 #[derive(Clone, PartialEq, PartialOrd, Hash, Debug, Serialize, Deserialize)]
 pub enum PrimitiveFieldValue {
-    UnsignedInteger(u64, PreferredDisplayBase),
-    SignedInteger(i64, PreferredDisplayBase),
-    String(String),
+    UnsignedInteger(u64),
+    SignedInteger(i64),
+    String(Arc<str>),
     F32(OrderedFloat<f32>),
     F64(OrderedFloat<f64>),
-    Enumeration(i64, PreferredDisplayBase, Option<Intern<String>>),
+    /// NOTE: unsigned enumeration values are always converted to signed
+    Enumeration(i64),
+}
+
+/// Static and dynamic array field values, one typed buffer per element type.
+/// Enumeration elements are stored as their underlying integer type.
+#[derive(Clone, PartialEq, PartialOrd, Hash, Debug, Serialize, Deserialize)]
+pub enum ArrayFieldValue {
+    U8(Vec<u8>),
+    U16(Vec<u16>),
+    U32(Vec<u32>),
+    U64(Vec<u64>),
+    I8(Vec<i8>),
+    I16(Vec<i16>),
+    I32(Vec<i32>),
+    I64(Vec<i64>),
+    F32(Vec<OrderedFloat<f32>>),
+    F64(Vec<OrderedFloat<f64>>),
+    String(Vec<Arc<str>>),
+}
+
+impl ArrayFieldValue {
+    /// Number of elements in the array
+    pub fn len(&self) -> usize {
+        match self {
+            Self::U8(v) => v.len(),
+            Self::U16(v) => v.len(),
+            Self::U32(v) => v.len(),
+            Self::U64(v) => v.len(),
+            Self::I8(v) => v.len(),
+            Self::I16(v) => v.len(),
+            Self::I32(v) => v.len(),
+            Self::I64(v) => v.len(),
+            Self::F32(v) => v.len(),
+            Self::F64(v) => v.len(),
+            Self::String(v) => v.len(),
+        }
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Return the element at `index` as a [`PrimitiveFieldValue`]
+    pub fn get(&self, index: usize) -> Option<PrimitiveFieldValue> {
+        Some(match self {
+            Self::U8(v) => (*v.get(index)?).into(),
+            Self::U16(v) => (*v.get(index)?).into(),
+            Self::U32(v) => (*v.get(index)?).into(),
+            Self::U64(v) => (*v.get(index)?).into(),
+            Self::I8(v) => (*v.get(index)?).into(),
+            Self::I16(v) => (*v.get(index)?).into(),
+            Self::I32(v) => (*v.get(index)?).into(),
+            Self::I64(v) => (*v.get(index)?).into(),
+            Self::F32(v) => PrimitiveFieldValue::F32(*v.get(index)?),
+            Self::F64(v) => PrimitiveFieldValue::F64(*v.get(index)?),
+            Self::String(v) => v.get(index)?.clone().into(),
+        })
+    }
 }
 
 #[derive(Clone, PartialEq, PartialOrd, Hash, Debug, Serialize, Deserialize)]
 pub enum FieldValue {
     Primitive(PrimitiveFieldValue),
-    Array(Vec<PrimitiveFieldValue>),
+    Array(ArrayFieldValue),
 }
 
 impl From<PrimitiveFieldValue> for FieldValue {
@@ -223,69 +306,75 @@ impl From<PrimitiveFieldValue> for FieldValue {
     }
 }
 
-impl From<Vec<PrimitiveFieldValue>> for FieldValue {
-    fn from(v: Vec<PrimitiveFieldValue>) -> Self {
+impl From<ArrayFieldValue> for FieldValue {
+    fn from(v: ArrayFieldValue) -> Self {
         Self::Array(v)
     }
 }
 
 impl From<u8> for PrimitiveFieldValue {
     fn from(v: u8) -> Self {
-        PrimitiveFieldValue::UnsignedInteger(v.into(), PreferredDisplayBase::default())
+        PrimitiveFieldValue::UnsignedInteger(v.into())
     }
 }
 
 impl From<u16> for PrimitiveFieldValue {
     fn from(v: u16) -> Self {
-        PrimitiveFieldValue::UnsignedInteger(v.into(), PreferredDisplayBase::default())
+        PrimitiveFieldValue::UnsignedInteger(v.into())
     }
 }
 
 impl From<u32> for PrimitiveFieldValue {
     fn from(v: u32) -> Self {
-        PrimitiveFieldValue::UnsignedInteger(v.into(), PreferredDisplayBase::default())
+        PrimitiveFieldValue::UnsignedInteger(v.into())
     }
 }
 
 impl From<u64> for PrimitiveFieldValue {
     fn from(v: u64) -> Self {
-        PrimitiveFieldValue::UnsignedInteger(v, PreferredDisplayBase::default())
+        PrimitiveFieldValue::UnsignedInteger(v)
     }
 }
 
 impl From<i8> for PrimitiveFieldValue {
     fn from(v: i8) -> Self {
-        PrimitiveFieldValue::SignedInteger(v.into(), PreferredDisplayBase::default())
+        PrimitiveFieldValue::SignedInteger(v.into())
     }
 }
 
 impl From<i16> for PrimitiveFieldValue {
     fn from(v: i16) -> Self {
-        PrimitiveFieldValue::SignedInteger(v.into(), PreferredDisplayBase::default())
+        PrimitiveFieldValue::SignedInteger(v.into())
     }
 }
 
 impl From<i32> for PrimitiveFieldValue {
     fn from(v: i32) -> Self {
-        PrimitiveFieldValue::SignedInteger(v.into(), PreferredDisplayBase::default())
+        PrimitiveFieldValue::SignedInteger(v.into())
     }
 }
 
 impl From<i64> for PrimitiveFieldValue {
     fn from(v: i64) -> Self {
-        PrimitiveFieldValue::SignedInteger(v, PreferredDisplayBase::default())
+        PrimitiveFieldValue::SignedInteger(v)
+    }
+}
+
+impl From<Arc<str>> for PrimitiveFieldValue {
+    fn from(v: Arc<str>) -> Self {
+        PrimitiveFieldValue::String(v)
     }
 }
 
 impl From<String> for PrimitiveFieldValue {
     fn from(v: String) -> Self {
-        PrimitiveFieldValue::String(v)
+        PrimitiveFieldValue::String(v.into())
     }
 }
 
 impl From<&str> for PrimitiveFieldValue {
     fn from(v: &str) -> Self {
-        PrimitiveFieldValue::String(v.to_owned())
+        PrimitiveFieldValue::String(v.into())
     }
 }
 
@@ -376,6 +465,19 @@ mod test {
         assert_eq!(t1, t2);
     }
 
+    #[test]
+    fn rollover_tracking_from_timestamp() {
+        let mut instant = TrackingInstant::new(&timestamp_ft(16)).unwrap();
+        instant.reset_to_timestamp(0x1234_FFF0);
+        assert_eq!(instant.as_timestamp(), 0x1234_FFF0);
+        assert_eq!(instant.elapsed(0xFFF8), 0x1234_FFF8);
+        assert_eq!(instant.elapsed(0x0004), 0x1235_0004);
+
+        let mut instant = TrackingInstant::new(&timestamp_ft(64)).unwrap();
+        instant.reset_to_timestamp(u64::MAX - 1);
+        assert_eq!(instant.elapsed(5), 5);
+    }
+
     #[test]
     fn unsupported_timestamp_field_type() {
         assert_eq!(
@@ -383,4 +485,10 @@ mod test {
             Err(UnsupportedTimestampFieldType {})
         );
     }
+
+    #[test]
+    fn compact_field_values() {
+        // Largest variant is the Arc<str> fat pointer
+        assert!(std::mem::size_of::<PrimitiveFieldValue>() <= 24);
+    }
 }
@@ -1,6 +1,6 @@
 use crate::{
     config::ClockType,
-    types::{Event, EventCount, FieldValue, SequenceNumber, StreamId, Timestamp},
+    types::{Event, EventCount, FieldSchema, FieldValue, SequenceNumber, StreamId, Timestamp},
 };
 use internment::Intern;
 use serde::{Deserialize, Serialize};
@@ -50,7 +50,8 @@ pub struct PacketContext {
     /// Per-stream event packet sequence count.
     pub sequence_number: Option<SequenceNumber>,
     /// Extra, user-defined members to be appended to this data stream type’s packet context structure field type.
-    pub extra_members: Vec<(Intern<String>, FieldValue)>,
+    #[serde(with = "crate::types::schema::named_members")]
+    pub extra_members: Vec<(Intern<FieldSchema>, FieldValue)>,
 }
 
 impl PacketContext {
@@ -0,0 +1,123 @@
+use crate::types::{EventSchema, StreamId};
+use internment::Intern;
+use serde::{Deserialize, Serialize};
+use std::{
+    sync::atomic::{AtomicU64, Ordering},
+    time::Duration,
+};
+
+/// Number of decode time histogram buckets, bucket `i` counts the events
+/// decoded in under 2^`i` nanoseconds (and at least 2^(`i`-1)), the last one
+/// takes everything slower
+pub const PROFILE_BUCKETS: usize = 32;
+
+/// Decode cost of an event record type, see [`Parser::profile`](crate::Parser::profile)
+#[derive(Clone, PartialEq, Debug, Serialize, Deserialize)]
+pub struct EventProfile {
+    pub stream_id: StreamId,
+    pub schema: Intern<EventSchema>,
+    /// Events decoded
+    pub events: u64,
+    /// Bits consumed by the events, including the alignment padding ahead of their headers
+    pub bits: u64,
+    /// Total decode time
+    pub time: Duration,
+    /// Decode time histogram, see [`PROFILE_BUCKETS`]
+    pub histogram: [u64; PROFILE_BUCKETS],
+}
+
+impl EventProfile {
+    /// Mean decode time per event
+    pub fn mean_time(&self) -> Duration {
+        if self.events == 0 {
+            Duration::ZERO
+        } else {
+            Duration::from_nanos((self.time.as_nanos() / u128::from(self.events)) as u64)
+        }
+    }
+
+    /// Mean bytes consumed per event
+    pub fn mean_bytes(&self) -> f64 {
+        if self.events == 0 {
+            0.0
+        } else {
+            self.bits as f64 / 8.0 / self.events as f64
+        }
+    }
+
+    /// Upper bound of the decode time histogram bucket holding the `q` quantile
+    /// (0.0 to 1.0)
+    pub fn quantile_time(&self, q: f64) -> Duration {
+        let rank = (q.clamp(0.0, 1.0) * self.events as f64).ceil().max(1.0) as u64;
+        let mut seen = 0;
+        for (i, n) in self.histogram.iter().enumerate() {
+            seen += n;
+            if seen >= rank {
+                return Duration::from_nanos(1 << i);
+            }
+        }
+        Duration::from_nanos(1 << (PROFILE_BUCKETS - 1))
+    }
+}
+
+/// Accumulates an event record type's [`EventProfile`]
+#[derive(Debug, Default)]
+pub(crate) struct EventProfileTracker {
+    events: AtomicU64,
+    bits: AtomicU64,
+    nanos: AtomicU64,
+    histogram: [AtomicU64; PROFILE_BUCKETS],
+}
+
+impl EventProfileTracker {
+    pub fn record(&self, time: Duration, bits: usize) {
+        let nanos = u64::try_from(time.as_nanos()).unwrap_or(u64::MAX);
+        let bucket = ((u64::BITS - nanos.leading_zeros()) as usize).min(PROFILE_BUCKETS - 1);
+        self.events.fetch_add(1, Ordering::Relaxed);
+        self.bits.fetch_add(bits as u64, Ordering::Relaxed);
+        self.nanos.fetch_add(nanos, Ordering::Relaxed);
+        self.histogram[bucket].fetch_add(1, Ordering::Relaxed);
+    }
+
+    pub fn snapshot(&self, stream_id: StreamId, schema: Intern<EventSchema>) -> EventProfile {
+        EventProfile {
+            stream_id,
+            schema,
+            events: self.events.load(Ordering::Relaxed),
+            bits: self.bits.load(Ordering::Relaxed),
+            time: Duration::from_nanos(self.nanos.load(Ordering::Relaxed)),
+            histogram: std::array::from_fn(|i| self.histogram[i].load(Ordering::Relaxed)),
+        }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use crate::types::EventSchema;
+
+    #[test]
+    fn profile_histogram() {
+        let t = EventProfileTracker::default();
+        for nanos in [0, 1, 3, 100, 100, 100, 5_000] {
+            t.record(Duration::from_nanos(nanos), 16);
+        }
+        let p = t.snapshot(
+            0,
+            Intern::new(EventSchema::new(0, "e", None, &[], &[], &[])),
+        );
+        assert_eq!(p.events, 7);
+        assert_eq!(p.bits, 7 * 16);
+        assert_eq!(p.mean_bytes(), 2.0);
+        assert_eq!(p.mean_time(), Duration::from_nanos(5_304 / 7));
+        assert_eq!(p.histogram.iter().sum::<u64>(), 7);
+        assert_eq!(p.histogram[0], 1);
+        assert_eq!(p.histogram[1], 1);
+        assert_eq!(p.histogram[2], 1);
+        assert_eq!(p.histogram[7], 3);
+        assert_eq!(p.histogram[13], 1);
+        assert_eq!(p.quantile_time(0.5), Duration::from_nanos(128));
+        assert_eq!(p.quantile_time(1.0), Duration::from_nanos(8192));
+        assert_eq!(p.quantile_time(0.0), Duration::from_nanos(1));
+    }
+}
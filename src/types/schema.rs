@@ -0,0 +1,484 @@
+use crate::{
+    config::{
+        EnumerationFieldTypeMappingSequence, FieldType, PreferredDisplayBase,
+        StructureMemberFieldType,
+    },
+    types::{EventId, FieldValue, LogLevel, PrimitiveFieldValue},
+};
+use fxhash::FxHashMap;
+use internment::Intern;
+use serde::{Deserialize, Deserializer, Serialize, Serializer};
+use std::{
+    hash::{Hash, Hasher},
+    ops::Range,
+};
+
+/// Schema of a structure member (packet context extra member, event context
+/// or payload member), shared by all of its decoded values.
+/// Display details that are fixed by the configuration live here rather than
+/// in each [`PrimitiveFieldValue`].
+#[derive(Clone, Eq, PartialEq, Hash, Debug, Serialize, Deserialize)]
+pub struct FieldSchema {
+    /// Member name
+    pub name: Intern<String>,
+    /// The preferred base (radix) to use when displaying the member's values, if applicable.
+    pub preferred_display_base: Option<PreferredDisplayBase>,
+    /// Value labels of enumeration members.
+    pub enum_mappings: Option<EnumerationMappings>,
+}
+
+impl FieldSchema {
+    pub(crate) fn from_struct_ft(name: &str, ft: &StructureMemberFieldType) -> Self {
+        Self {
+            name: Intern::new(name.to_owned()),
+            preferred_display_base: ft.preferred_display_base(),
+            enum_mappings: EnumerationMappings::from_struct_ft(ft),
+        }
+    }
+
+    /// A schema with only a name, for deserialized members, see [`NamedMembers`]
+    pub(crate) fn named(name: Intern<String>) -> Intern<Self> {
+        Intern::new(Self {
+            name,
+            preferred_display_base: None,
+            enum_mappings: None,
+        })
+    }
+
+    /// The preferred base (radix) to use when displaying the member's values.
+    pub fn display_base(&self) -> PreferredDisplayBase {
+        self.preferred_display_base.unwrap_or_default()
+    }
+
+    /// Return the label of an enumeration value of this member, if any.
+    pub fn label(&self, value: &PrimitiveFieldValue) -> Option<Intern<String>> {
+        match value {
+            PrimitiveFieldValue::Enumeration(v) => self.enum_mappings.as_ref()?.label(*v),
+            _ => None,
+        }
+    }
+}
+
+/// Serialized form of structure member values, `(name, value)` pairs.
+///
+/// The rest of the [`FieldSchema`] (display base, enumeration mappings) comes from
+/// the configuration and isn't repeated for every value, deserialized members
+/// only have a name.
+pub(crate) struct NamedMembers<'a>(pub &'a [Intern<FieldSchema>], pub &'a [FieldValue]);
+
+impl Serialize for NamedMembers<'_> {
+    fn serialize<S: Serializer>(&self, s: S) -> Result<S::Ok, S::Error> {
+        s.collect_seq(self.0.iter().map(|m| m.name).zip(self.1))
+    }
+}
+
+/// Deserialized [`NamedMembers`], their schemas and values
+pub(crate) type Members = (Vec<Intern<FieldSchema>>, Vec<FieldValue>);
+
+impl NamedMembers<'_> {
+    pub fn deserialize_schemas<'de, D: Deserializer<'de>>(d: D) -> Result<Members, D::Error> {
+        let members: Vec<(Intern<String>, FieldValue)> = Deserialize::deserialize(d)?;
+        Ok(members
+            .into_iter()
+            .map(|(name, v)| (FieldSchema::named(name), v))
+            .unzip())
+    }
+}
+
+/// `serialize_with`/`deserialize_with` of a `Vec<(Intern<FieldSchema>, FieldValue)>`
+/// as [`NamedMembers`]
+pub(crate) mod named_members {
+    use super::*;
+
+    pub fn serialize<S: Serializer>(
+        members: &[(Intern<FieldSchema>, FieldValue)],
+        s: S,
+    ) -> Result<S::Ok, S::Error> {
+        s.collect_seq(members.iter().map(|(m, v)| (m.name, v)))
+    }
+
+    pub fn deserialize<'de, D: Deserializer<'de>>(
+        d: D,
+    ) -> Result<Vec<(Intern<FieldSchema>, FieldValue)>, D::Error> {
+        let (schemas, values) = NamedMembers::deserialize_schemas(d)?;
+        Ok(schemas.into_iter().zip(values).collect())
+    }
+}
+
+/// Schema of an event record type, shared by all of its decoded events.
+/// An [`Event`](crate::types::Event) holds its member values positionally:
+/// the common context members first, then the specific context members,
+/// then the payload members.
+#[derive(Clone, Debug, Serialize, Deserialize)]
+#[serde(from = "EventSchemaFields")]
+pub struct EventSchema {
+    id: EventId,
+    name: Intern<String>,
+    log_level: Option<LogLevel>,
+    members: Vec<Intern<FieldSchema>>,
+    specific_context_start: usize,
+    payload_start: usize,
+    /// Member name to position, the most specific section wins
+    #[serde(skip)]
+    index: FxHashMap<Box<str>, usize>,
+}
+
+/// The serialized part of an [`EventSchema`], the name index is rebuilt
+#[derive(Deserialize)]
+struct EventSchemaFields {
+    id: EventId,
+    name: Intern<String>,
+    log_level: Option<LogLevel>,
+    members: Vec<Intern<FieldSchema>>,
+    specific_context_start: usize,
+    payload_start: usize,
+}
+
+impl From<EventSchemaFields> for EventSchema {
+    fn from(f: EventSchemaFields) -> Self {
+        let index = Self::build_index(&f.members);
+        Self {
+            id: f.id,
+            name: f.name,
+            log_level: f.log_level,
+            members: f.members,
+            specific_context_start: f.specific_context_start,
+            payload_start: f.payload_start,
+            index,
+        }
+    }
+}
+
+impl EventSchema {
+    pub(crate) fn new(
+        id: EventId,
+        name: &str,
+        log_level: Option<LogLevel>,
+        common_context: &[Intern<FieldSchema>],
+        specific_context: &[Intern<FieldSchema>],
+        payload: &[Intern<FieldSchema>],
+    ) -> Self {
+        let members: Vec<Intern<FieldSchema>> = common_context
+            .iter()
+            .chain(specific_context)
+            .chain(payload)
+            .copied()
+            .collect();
+        Self {
+            id,
+            name: Intern::new(name.to_owned()),
+            log_level,
+            specific_context_start: common_context.len(),
+            payload_start: common_context.len() + specific_context.len(),
+            index: Self::build_index(&members),
+            members,
+        }
+    }
+
+    fn build_index(members: &[Intern<FieldSchema>]) -> FxHashMap<Box<str>, usize> {
+        // Later sections overwrite earlier ones
+        members
+            .iter()
+            .enumerate()
+            .map(|(pos, m)| (m.name.as_str().into(), pos))
+            .collect()
+    }
+
+    pub fn id(&self) -> EventId {
+        self.id
+    }
+
+    pub fn name(&self) -> Intern<String> {
+        self.name
+    }
+
+    pub fn log_level(&self) -> Option<LogLevel> {
+        self.log_level
+    }
+
+    /// Number of member values of each event
+    pub fn len(&self) -> usize {
+        self.members.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.members.is_empty()
+    }
+
+    /// All member schemas, in value order
+    pub fn members(&self) -> &[Intern<FieldSchema>] {
+        &self.members
+    }
+
+    /// Position of the common context members in the event values
+    pub fn common_context(&self) -> Range<usize> {
+        0..self.specific_context_start
+    }
+
+    /// Position of the specific context members in the event values
+    pub fn specific_context(&self) -> Range<usize> {
+        self.specific_context_start..self.payload_start
+    }
+
+    /// Position of the payload members in the event values
+    pub fn payload(&self) -> Range<usize> {
+        self.payload_start..self.members.len()
+    }
+
+    /// Position of a member in the event values, by name.
+    /// Payload members shadow specific context members, which shadow
+    /// common context members.
+    pub fn position(&self, name: &str) -> Option<usize> {
+        self.index.get(name).copied()
+    }
+}
+
+impl PartialEq for EventSchema {
+    fn eq(&self, other: &Self) -> bool {
+        // The index is derived from the members
+        self.id == other.id
+            && self.name == other.name
+            && self.log_level == other.log_level
+            && self.members == other.members
+            && self.specific_context_start == other.specific_context_start
+            && self.payload_start == other.payload_start
+    }
+}
+
+impl Eq for EventSchema {}
+
+impl Hash for EventSchema {
+    fn hash<H: Hasher>(&self, state: &mut H) {
+        self.id.hash(state);
+        self.name.hash(state);
+        self.log_level.hash(state);
+        self.members.hash(state);
+        self.specific_context_start.hash(state);
+        self.payload_start.hash(state);
+    }
+}
+
+/// Enumeration value to label lookup table, compiled from the mappings of
+/// an enumeration field type.
+///
+/// barectf allows mapping ranges to overlap, the label that sorts first wins,
+/// so the mappings are flattened into disjoint intervals up front.
+#[derive(Clone, Eq, PartialEq, Hash, Debug, Serialize, Deserialize)]
+pub enum EnumerationMappings {
+    /// Direct-indexed table over a small value range, starting at `min`
+    Dense {
+        min: i64,
+        labels: Vec<Option<Intern<String>>>,
+    },
+    /// Disjoint `(first, last, label)` inclusive intervals, sorted by `first`
+    Intervals(Vec<(i64, i64, Intern<String>)>),
+}
+
+impl EnumerationMappings {
+    /// Largest value range covered by a [`EnumerationMappings::Dense`] table
+    const MAX_DENSE_LEN: usize = 1024;
+
+    pub(crate) fn from_struct_ft(ft: &StructureMemberFieldType) -> Option<Self> {
+        match ft {
+            StructureMemberFieldType::UnsignedEnumeration(t)
+            | StructureMemberFieldType::SignedEnumeration(t) => {
+                Some(Self::new(t.mappings.iter().map(|(label, seq)| {
+                    (Intern::new(label.clone()), seq.as_slice())
+                })))
+            }
+            _ => None,
+        }
+    }
+
+    /// Compile the mappings, given in priority order
+    fn new<'a, I>(mappings: I) -> Self
+    where
+        I: IntoIterator<Item = (Intern<String>, &'a [EnumerationFieldTypeMappingSequence])>,
+    {
+        // (first, last, priority, label), in i128 so `last + 1` can't overflow
+        let mut ranges = Vec::new();
+        for (priority, (label, seq)) in mappings.into_iter().enumerate() {
+            for s in seq.iter() {
+                let (first, last) = match s {
+                    EnumerationFieldTypeMappingSequence::InclusiveRange(min, max) => (*min, *max),
+                    EnumerationFieldTypeMappingSequence::Value(v) => (*v, *v),
+                };
+                if first <= last {
+                    ranges.push((i128::from(first), i128::from(last), priority, label));
+                }
+            }
+        }
+
+        // Split the value space at every range boundary, each segment
+        // then maps to the highest priority range covering it
+        let mut bounds: Vec<i128> = ranges
+            .iter()
+            .flat_map(|(first, last, _, _)| [*first, *last + 1])
+            .collect();
+        bounds.sort_unstable();
+        bounds.dedup();
+
+        let mut intervals: Vec<(i64, i64, Intern<String>)> = Vec::new();
+        for seg in bounds.windows(2) {
+            let (first, last) = (seg[0], seg[1] - 1);
+            let Some(label) = ranges
+                .iter()
+                .filter(|(f, l, _, _)| *f <= first && last <= *l)
+                .min_by_key(|(_, _, priority, _)| *priority)
+                .map(|(_, _, _, label)| *label)
+            else {
+                continue;
+            };
+            // Both ends come from i64 values
+            let (first, last) = (first as i64, last as i64);
+            match intervals.last_mut() {
+                Some(prev) if prev.2 == label && i128::from(prev.1) + 1 == i128::from(first) => {
+                    prev.1 = last;
+                }
+                _ => intervals.push((first, last, label)),
+            }
+        }
+
+        match (intervals.first(), intervals.last()) {
+            (Some((min, _, _)), Some((_, max, _)))
+                if (i128::from(*max) - i128::from(*min)) < Self::MAX_DENSE_LEN as i128 =>
+            {
+                let mut labels = vec![None; (max - min) as usize + 1];
+                for (first, last, label) in intervals.iter() {
+                    for v in *first..=*last {
+                        labels[(v - min) as usize] = Some(*label);
+                    }
+                }
+                Self::Dense { min: *min, labels }
+            }
+            _ => Self::Intervals(intervals),
+        }
+    }
+
+    /// Return the label mapped to the value, if any
+    pub fn label(&self, v: i64) -> Option<Intern<String>> {
+        match self {
+            Self::Dense { min, labels } => {
+                // Values below `min` wrap around past the end of the table
+                let index = v.wrapping_sub(*min) as u64;
+                labels.get(usize::try_from(index).ok()?).copied().flatten()
+            }
+            Self::Intervals(intervals) => {
+                let i = intervals.partition_point(|(first, _, _)| *first <= v);
+                let (_, last, label) = intervals.get(i.checked_sub(1)?)?;
+                (v <= *last).then_some(*label)
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    fn mappings(
+        labels: &[(&str, Vec<EnumerationFieldTypeMappingSequence>)],
+    ) -> Vec<(Intern<String>, Vec<EnumerationFieldTypeMappingSequence>)> {
+        labels
+            .iter()
+            .map(|(l, seq)| (Intern::new(l.to_string()), seq.clone()))
+            .collect()
+    }
+
+    fn check_against_linear_scan(
+        mappings: &[(Intern<String>, Vec<EnumerationFieldTypeMappingSequence>)],
+        values: impl Iterator<Item = i64>,
+    ) -> EnumerationMappings {
+        let compiled =
+            EnumerationMappings::new(mappings.iter().map(|(l, seq)| (*l, seq.as_slice())));
+        for v in values {
+            let expected = mappings
+                .iter()
+                .find_map(|(label, seq)| seq.iter().any(|s| s.contains(v)).then_some(*label));
+            assert_eq!(compiled.label(v), expected, "value {v}");
+        }
+        compiled
+    }
+
+    #[test]
+    fn enum_mappings_dense() {
+        use EnumerationFieldTypeMappingSequence::*;
+        let m = mappings(&[
+            (
+                "RUNNING",
+                vec![Value(17), InclusiveRange(19, 24), Value(-144)],
+            ),
+            ("STOPPED", vec![Value(202)]),
+            ("WAITING", vec![Value(18), InclusiveRange(-32, -25)]),
+        ]);
+        let compiled = check_against_linear_scan(&m, (-300..300).chain([i64::MIN, i64::MAX]));
+        assert!(matches!(
+            compiled,
+            EnumerationMappings::Dense { min: -144, .. }
+        ));
+    }
+
+    #[test]
+    fn enum_mappings_intervals() {
+        use EnumerationFieldTypeMappingSequence::*;
+        let m = mappings(&[
+            ("on/off", vec![Value(15), InclusiveRange(200, 1000)]),
+            ("steam-machine", vec![Value(18), Value(i64::MAX)]),
+            (
+                "the-prime-time-of-your-life",
+                vec![Value(2), Value(i64::MIN)],
+            ),
+        ]);
+        let compiled = check_against_linear_scan(
+            &m,
+            (-10..1200).chain([i64::MIN, i64::MIN + 1, i64::MAX - 1, i64::MAX]),
+        );
+        assert!(matches!(compiled, EnumerationMappings::Intervals(_)));
+    }
+
+    #[test]
+    fn enum_mappings_overlapping_ranges() {
+        use EnumerationFieldTypeMappingSequence::*;
+        let m = mappings(&[
+            (
+                "A",
+                vec![InclusiveRange(10, 20), InclusiveRange(5000, 6000)],
+            ),
+            ("B", vec![InclusiveRange(0, 100_000), InclusiveRange(3, 1)]),
+            ("C", vec![InclusiveRange(15, 5500)]),
+        ]);
+        check_against_linear_scan(&m, -5..7000);
+        check_against_linear_scan(&m[..1], -5..7000);
+        check_against_linear_scan(&m[2..], -5..7000);
+        check_against_linear_scan(&[], -5..5);
+    }
+
+    #[test]
+    fn event_schema_sections() {
+        let member = |name: &str| {
+            Intern::new(FieldSchema {
+                name: Intern::new(name.to_owned()),
+                preferred_display_base: None,
+                enum_mappings: None,
+            })
+        };
+        let schema = EventSchema::new(
+            3,
+            "ev",
+            None,
+            &[member("a"), member("b")],
+            &[member("b")],
+            &[member("c"), member("a")],
+        );
+        assert_eq!(schema.len(), 5);
+        assert_eq!(schema.common_context(), 0..2);
+        assert_eq!(schema.specific_context(), 2..3);
+        assert_eq!(schema.payload(), 3..5);
+
+        // Most specific section wins
+        assert_eq!(schema.position("a"), Some(4));
+        assert_eq!(schema.position("b"), Some(2));
+        assert_eq!(schema.position("c"), Some(3));
+        assert_eq!(schema.position("d"), None);
+    }
+}
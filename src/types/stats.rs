@@ -0,0 +1,126 @@
+use crate::types::{EventCount, PacketContext, SequenceNumber};
+use serde::{Deserialize, Serialize};
+
+/// Per-stream packet accounting, see [`Parser::stream_stats`](crate::Parser::stream_stats).
+///
+/// The packet counters other than `packets` require the stream's sequence number
+/// feature, and the event counters its discarded event records counter snapshot feature.
+#[derive(Copy, Clone, Eq, PartialEq, Hash, Debug, Default, Serialize, Deserialize)]
+pub struct StreamStats {
+    /// Packets decoded
+    pub packets: u64,
+    /// Packets missing from gaps in the sequence numbers
+    pub missing_packets: u64,
+    /// Packets whose sequence number isn't past the highest one seen so far
+    pub out_of_order_packets: u64,
+    /// Events discarded by the producer, the sum of the discarded event counter
+    /// increases between packets
+    pub discarded_events: EventCount,
+    /// Packets whose discarded event counter increased
+    pub packets_with_discarded_events: u64,
+    /// Largest discarded event counter increase between two packets
+    pub max_discarded_events_delta: EventCount,
+}
+
+/// Tracks a stream's [`StreamStats`] across its packets
+#[derive(Clone, Debug)]
+pub(crate) struct StreamStatsTracker {
+    stats: StreamStats,
+    /// Largest value of the sequence number field type, for wrapping
+    sequence_number_max: SequenceNumber,
+    /// Largest value of the discarded event counter field type, for wrapping
+    events_discarded_max: EventCount,
+    last_sequence_number: Option<SequenceNumber>,
+    last_events_discarded: EventCount,
+}
+
+impl StreamStatsTracker {
+    pub fn new(sequence_number_max: SequenceNumber, events_discarded_max: EventCount) -> Self {
+        Self {
+            stats: StreamStats::default(),
+            sequence_number_max,
+            events_discarded_max,
+            last_sequence_number: None,
+            last_events_discarded: 0,
+        }
+    }
+
+    pub fn stats(&self) -> StreamStats {
+        self.stats
+    }
+
+    pub fn record(&mut self, context: &PacketContext) {
+        self.stats.packets += 1;
+
+        if let Some(seq) = context.sequence_number {
+            if let Some(last) = self.last_sequence_number {
+                // Deltas past half the field type range are taken as going backwards
+                let delta = seq.wrapping_sub(last) & self.sequence_number_max;
+                if delta == 0 || delta > self.sequence_number_max / 2 {
+                    // The counter snapshot is stale too
+                    self.stats.out_of_order_packets += 1;
+                    return;
+                }
+                self.stats.missing_packets += delta - 1;
+            }
+            self.last_sequence_number = Some(seq);
+        }
+
+        if let Some(snapshot) = context.events_discarded {
+            let delta =
+                snapshot.wrapping_sub(self.last_events_discarded) & self.events_discarded_max;
+            self.last_events_discarded = snapshot;
+            if delta != 0 {
+                self.stats.discarded_events += delta;
+                self.stats.packets_with_discarded_events += 1;
+                self.stats.max_discarded_events_delta =
+                    self.stats.max_discarded_events_delta.max(delta);
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    fn context(sequence_number: u64, events_discarded: u64) -> PacketContext {
+        PacketContext {
+            packet_size_bits: 0,
+            content_size_bits: 0,
+            beginning_timestamp: None,
+            end_timestamp: None,
+            events_discarded: Some(events_discarded),
+            sequence_number: Some(sequence_number),
+            extra_members: Vec::new(),
+        }
+    }
+
+    #[test]
+    fn stream_stats_accounting() {
+        let mut t = StreamStatsTracker::new(u8::MAX.into(), u8::MAX.into());
+        for (seq, discarded) in [
+            (0, 0),
+            (1, 0),
+            (4, 3), // 2 missing, 3 discarded
+            (3, 2), // Out of order
+            (5, 10),
+            (100, 10), // 94 missing
+            (200, 12), // 99 missing
+            (10, 1),   // Both wrap, 65 missing
+        ] {
+            t.record(&context(seq, discarded));
+        }
+        assert_eq!(
+            t.stats(),
+            StreamStats {
+                packets: 8,
+                missing_packets: 2 + 94 + 99 + 65,
+                out_of_order_packets: 1,
+                discarded_events: 3 + 7 + 2 + 245,
+                packets_with_discarded_events: 4,
+                max_discarded_events_delta: 245,
+            }
+        );
+    }
+}
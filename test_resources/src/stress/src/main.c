@@ -0,0 +1,317 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include <inttypes.h>
+#include <getopt.h>
+#include <assert.h>
+
+#include "barectf_platform_linux_fs.h"
+#include "barectf.h"
+
+#define DEFAULT_EVENTS (1000000)
+#define DEFAULT_PACKET_SIZE (4096)
+#define DEFAULT_INTERVAL (100)
+#define DEFAULT_SEED (1)
+
+/* Packet sizes are in bits in the 32 bit total-size field */
+#define MIN_PACKET_SIZE (256)
+#define MAX_PACKET_SIZE (UINT32_MAX / 8)
+
+#define MAX_ARRAY_STRINGS (8)
+
+static const char VERSION[] = "1.0.0";
+
+static const char *STRINGS[] = {
+    "", "a", "idle", "sensor0", "motor-controller", "watchdog kicked",
+    "buffer high water mark reached",
+};
+#define NUM_STRINGS (sizeof(STRINGS) / sizeof(STRINGS[0]))
+
+typedef enum
+{
+    EVENT_INIT = 0,
+    EVENT_FOOBAR,
+    EVENT_FLOATS,
+    EVENT_ENUMS,
+    EVENT_ARRAYS,
+    EVENT_SHUTDOWN,
+    NUM_EVENTS,
+} event_kind;
+
+static const char *EVENT_NAMES[NUM_EVENTS] = {
+    "init", "foobar", "floats", "enums", "arrays", "shutdown",
+};
+
+/* Default mix, roughly what firmware emits: mostly small fixed-size events */
+static unsigned int g_mix[NUM_EVENTS] = {1, 60, 15, 15, 8, 1};
+
+static struct barectf_platform_linux_fs_ctx *g_platform_ctx;
+static struct barectf_default_ctx *g_probe = NULL;
+
+static uint64_t g_rng_state;
+
+/* xorshift64*, deterministic across platforms for a given seed */
+static uint64_t rng_next(void)
+{
+    g_rng_state ^= g_rng_state >> 12;
+    g_rng_state ^= g_rng_state << 25;
+    g_rng_state ^= g_rng_state >> 27;
+    return g_rng_state * UINT64_C(2685821657736338717);
+}
+
+static uint64_t rng_below(const uint64_t n)
+{
+    return rng_next() % n;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+        "Usage: %s [OPTIONS]\n"
+        "\n"
+        "Writes a barectf trace with a configurable number, size and mix of events.\n"
+        "\n"
+        "Options:\n"
+        "  -n, --events N         Number of events to write (default %d)\n"
+        "  -p, --packet-size N    Packet size in bytes (default %d)\n"
+        "  -m, --mix SPEC         Event weights, e.g. foobar=10,arrays=1 (default\n"
+        "                         init=1,foobar=60,floats=15,enums=15,arrays=8,shutdown=1)\n"
+        "                         Event types left out of SPEC aren't written\n"
+        "  -i, --interval N       Mean clock increment between events (default %d)\n"
+        "  -s, --seed N           Random seed (default %d)\n"
+        "  -o, --output FILE      Stream file (default " TRACE_DIR "/stream)\n"
+        "  -h, --help             Print this help\n",
+        prog, DEFAULT_EVENTS, DEFAULT_PACKET_SIZE, DEFAULT_INTERVAL, DEFAULT_SEED);
+}
+
+static int parse_u64(const char *s, uint64_t *out)
+{
+    char *end = NULL;
+    if(s[0] == '-')
+    {
+        return -1;
+    }
+    *out = strtoull(s, &end, 0);
+    return (end == s || *end != '\0') ? -1 : 0;
+}
+
+static int parse_mix(char *spec)
+{
+    unsigned int mix[NUM_EVENTS] = {0};
+    unsigned int total = 0;
+    char *saveptr = NULL;
+    char *item;
+
+    for(item = strtok_r(spec, ",", &saveptr); item != NULL; item = strtok_r(NULL, ",", &saveptr))
+    {
+        char *eq = strchr(item, '=');
+        uint64_t weight;
+        int i;
+
+        if(eq == NULL)
+        {
+            return -1;
+        }
+        *eq = '\0';
+        if(parse_u64(eq + 1, &weight) != 0 || weight > UINT16_MAX)
+        {
+            return -1;
+        }
+        for(i = 0; i < NUM_EVENTS; i += 1)
+        {
+            if(strcmp(item, EVENT_NAMES[i]) == 0)
+            {
+                break;
+            }
+        }
+        if(i == NUM_EVENTS)
+        {
+            return -1;
+        }
+        mix[i] = (unsigned int) weight;
+        total += (unsigned int) weight;
+    }
+
+    if(total == 0)
+    {
+        return -1;
+    }
+    memcpy(g_mix, mix, sizeof(g_mix));
+    return 0;
+}
+
+static event_kind pick_event(const unsigned int total_weight)
+{
+    unsigned int r = (unsigned int) rng_below(total_weight);
+    int i;
+
+    for(i = 0; i < NUM_EVENTS; i += 1)
+    {
+        if(r < g_mix[i])
+        {
+            return (event_kind) i;
+        }
+        r -= g_mix[i];
+    }
+    assert(0);
+    return EVENT_SHUTDOWN;
+}
+
+static void trace_event(const event_kind kind, const uint32_t ercc)
+{
+    switch(kind)
+    {
+        case EVENT_INIT:
+            barectf_default_trace_init(g_probe, ercc, (int32_t) rng_below(8), VERSION);
+            break;
+        case EVENT_FOOBAR:
+            /* Mostly small values, like counters and IDs */
+            barectf_default_trace_foobar(
+                    g_probe,
+                    ercc,
+                    (uint32_t) (rng_next() >> (32 + rng_below(32))),
+                    (uint16_t) rng_below(1024));
+            break;
+        case EVENT_FLOATS:
+        {
+            const double v = (double) (int64_t) rng_below(2000000) / 1000.0 - 1000.0;
+            barectf_default_trace_floats(g_probe, ercc, (float) v, v * 3.0);
+            break;
+        }
+        case EVENT_ENUMS:
+            barectf_default_trace_enums(
+                    g_probe,
+                    ercc,
+                    (uint8_t) rng_below(2),
+                    rng_below(2) ? -1 : -22,
+                    (int32_t) (17 + rng_below(8)),
+                    (uint32_t) (200 + rng_below(801)));
+            break;
+        case EVENT_ARRAYS:
+        {
+            uint16_t foo[4];
+            const char *bar[MAX_ARRAY_STRINGS];
+            const uint32_t bar_len = (uint32_t) rng_below(MAX_ARRAY_STRINGS + 1);
+            uint32_t i;
+
+            for(i = 0; i < 4; i += 1)
+            {
+                foo[i] = (uint16_t) rng_next();
+            }
+            for(i = 0; i < bar_len; i += 1)
+            {
+                bar[i] = STRINGS[rng_below(NUM_STRINGS)];
+            }
+            barectf_default_trace_arrays(g_probe, ercc, foo, bar_len, bar);
+            break;
+        }
+        case EVENT_SHUTDOWN:
+            barectf_default_trace_shutdown(g_probe, ercc);
+            break;
+        default:
+            assert(0);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static const struct option long_options[] =
+    {
+        {"events", required_argument, NULL, 'n'},
+        {"packet-size", required_argument, NULL, 'p'},
+        {"mix", required_argument, NULL, 'm'},
+        {"interval", required_argument, NULL, 'i'},
+        {"seed", required_argument, NULL, 's'},
+        {"output", required_argument, NULL, 'o'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    uint64_t events = DEFAULT_EVENTS;
+    uint64_t packet_size = DEFAULT_PACKET_SIZE;
+    uint64_t interval = DEFAULT_INTERVAL;
+    uint64_t seed = DEFAULT_SEED;
+    const char *output = TRACE_DIR "/stream";
+    unsigned int total_weight = 0;
+    uint64_t i;
+    int e;
+    int opt;
+
+    while((opt = getopt_long(argc, argv, "n:p:m:i:s:o:h", long_options, NULL)) != -1)
+    {
+        int err = 0;
+        switch(opt)
+        {
+            case 'n':
+                err = parse_u64(optarg, &events);
+                break;
+            case 'p':
+                err = parse_u64(optarg, &packet_size);
+                if(err == 0 && (packet_size < MIN_PACKET_SIZE || packet_size > MAX_PACKET_SIZE))
+                {
+                    fprintf(stderr, "Packet size must be within [%d, %" PRIu32 "] bytes\n",
+                            MIN_PACKET_SIZE, (uint32_t) MAX_PACKET_SIZE);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'm':
+                err = parse_mix(optarg);
+                break;
+            case 'i':
+                err = parse_u64(optarg, &interval);
+                break;
+            case 's':
+                err = parse_u64(optarg, &seed);
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'h':
+                usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                err = -1;
+                break;
+        }
+        if(err != 0)
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    for(e = 0; e < NUM_EVENTS; e += 1)
+    {
+        total_weight += g_mix[e];
+    }
+
+    /* xorshift state must be non-zero */
+    g_rng_state = seed ? seed : DEFAULT_SEED;
+
+    g_platform_ctx = barectf_platform_linux_fs_init(PLATFORM_CTX_DEFAULT, (unsigned int) packet_size, output);
+    if(g_platform_ctx == NULL)
+    {
+        fprintf(stderr, "Failed to open '%s'\n", output);
+        return EXIT_FAILURE;
+    }
+
+    g_probe = barectf_platform_linux_fs_get_ctx(g_platform_ctx);
+    assert(g_probe != NULL);
+
+    for(i = 0; i < events; i += 1)
+    {
+        /* Uniform jitter around the mean interval */
+        increment_clock(interval ? 1 + rng_below(2 * interval) : 0);
+        trace_event(pick_event(total_weight), (uint32_t) i);
+    }
+
+    barectf_platform_linux_fs_fini(g_platform_ctx);
+
+    fprintf(stderr, "Wrote %" PRIu64 " events in %" PRIu64 " byte packets to '%s'\n",
+            events, packet_size, output);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+use barectf_parser::{codegen::EventReader, *};
+use pretty_assertions::assert_eq;
+use std::borrow::Cow;
+use test_log::test;
+
+mod full {
+    include!("codegen/full.rs");
+}
+
+const CFG: &str = "test_resources/fixtures/full/effective_config.yaml";
+const STREAM: &str = "test_resources/fixtures/full/trace/stream";
+const GENERATED: &str = "tests/codegen/full.rs";
+
+fn config() -> Config {
+    let cfg_str = std::fs::read_to_string(CFG).unwrap();
+    serde_yaml::from_str(&cfg_str).unwrap()
+}
+
+#[test]
+fn generated_code_is_up_to_date() {
+    let generated = codegen::generate(&config()).unwrap();
+    assert_eq!(
+        generated,
+        std::fs::read_to_string(GENERATED).unwrap(),
+        "{GENERATED} is stale, regenerate it from {CFG}"
+    );
+}
+
+#[test]
+fn decode_full_trace() {
+    let parser = Parser::new(&config()).unwrap();
+    let stream = std::fs::read(STREAM).unwrap();
+
+    let mut records = Vec::new();
+    let mut pkt_buf = stream.as_slice();
+    while !pkt_buf.is_empty() {
+        let (header, context, offset) = parser.parse_packet_preamble(pkt_buf).unwrap();
+        assert_eq!(header.stream_id, full::default::STREAM_ID);
+        let mut r = EventReader::new(&pkt_buf[..context.content_size()], offset);
+        while !r.is_empty() {
+            records.push(full::default::decode_event(&mut r).unwrap());
+        }
+        pkt_buf = &pkt_buf[context.packet_size()..];
+    }
+
+    use full::default::*;
+    let record = |timestamp, ercc, event| Record {
+        timestamp,
+        common_context: CommonContext { ercc },
+        event,
+    };
+    assert_eq!(
+        records,
+        vec![
+            record(
+                0,
+                98,
+                Event::Init(Init {
+                    cpu_id: 1,
+                    version: Cow::Borrowed("1.0.0"),
+                })
+            ),
+            record(1, 97, Event::Foobar(Foobar { val: 3, val2: 21 })),
+            record(2, 96, Event::Floats(Floats { f32: 1.1, f64: 2.2 })),
+            record(
+                3,
+                95,
+                Event::Enums(Enums {
+                    foo: 0,
+                    bar: -1,
+                    biz: 19,
+                    baz: 200,
+                })
+            ),
+            record(
+                4,
+                94,
+                Event::Arrays(Arrays {
+                    foo: [1, 2, 3, 4],
+                    bar: vec!["b0".into(), "b1".into(), "b2".into()],
+                })
+            ),
+            record(5, 93, Event::Shutdown(Shutdown {})),
+        ]
+    );
+
+    let Event::Enums(e) = &records[3].event else {
+        panic!("Expected the enums event");
+    };
+    assert_eq!(
+        [e.foo_label(), e.bar_label(), e.biz_label(), e.baz_label()],
+        [Some("A"), Some("C"), Some("RUNNING"), Some("on/off")]
+    );
+}
@@ -0,0 +1,279 @@
+// @generated by barectf_parser::codegen, do not edit
+
+/// `default` data stream type
+#[allow(non_camel_case_types, dead_code, unreachable_code, unused_variables, clippy::all)]
+pub mod default {
+    use barectf_parser::{codegen::EventReader, Error};
+    #[allow(unused_imports)]
+    use std::borrow::Cow;
+
+    pub const STREAM_ID: u64 = 0;
+
+    /// Event record common context
+    #[derive(Clone, PartialEq, Debug)]
+    pub struct CommonContext {
+        pub ercc: u32,
+    }
+
+    impl CommonContext {
+        #[inline]
+        pub fn decode(r: &mut EventReader<'_>) -> Result<Self, Error> {
+            r.align::<4>()?;
+            let ercc = r.u32_le::<4>()?;
+            Ok(Self {
+                ercc,
+            })
+        }
+    }
+
+    /// `arrays` event record, specific context and payload
+    #[derive(Clone, PartialEq, Debug)]
+    pub struct Arrays<'a> {
+        pub foo: [u16; 4],
+        pub bar: Vec<Cow<'a, str>>,
+    }
+
+    impl<'a> Arrays<'a> {
+        pub const ID: u64 = 0;
+        pub const NAME: &'static str = "arrays";
+
+        #[inline]
+        pub fn decode(r: &mut EventReader<'a>) -> Result<Self, Error> {
+            r.align::<1>()?;
+            let foo = r.array::<_, 4>(|r| r.u16_le::<1>())?;
+            let bar = {
+                let len = r.u32_le::<1>()? as usize;
+                r.align::<1>()?;
+                r.vec(len, |r| r.str())?
+            };
+            Ok(Self {
+                foo,
+                bar,
+            })
+        }
+    }
+
+    /// `enums` event record, specific context and payload
+    #[derive(Clone, PartialEq, Debug)]
+    pub struct Enums {
+        pub foo: u8,
+        pub bar: i16,
+        pub biz: i32,
+        pub baz: u32,
+    }
+
+    impl Enums {
+        pub const ID: u64 = 1;
+        pub const NAME: &'static str = "enums";
+
+        #[inline]
+        pub fn decode(r: &mut EventReader<'_>) -> Result<Self, Error> {
+            r.align::<4>()?;
+            let foo = r.u8_le::<1>()?;
+            let bar = r.i16_le::<1>()?;
+            let biz = r.i32_le::<4>()?;
+            let baz = r.u32_le::<1>()?;
+            Ok(Self {
+                foo,
+                bar,
+                biz,
+                baz,
+            })
+        }
+
+        /// Label of the `foo` value, if any
+        #[allow(unreachable_patterns)]
+        pub fn foo_label(&self) -> Option<&'static str> {
+            match self.foo {
+                0 => Some("A"),
+                1 => Some("B"),
+                _ => None,
+            }
+        }
+
+        /// Label of the `bar` value, if any
+        #[allow(unreachable_patterns)]
+        pub fn bar_label(&self) -> Option<&'static str> {
+            match self.bar {
+                -1 => Some("C"),
+                -22 => Some("D"),
+                _ => None,
+            }
+        }
+
+        /// Label of the `biz` value, if any
+        #[allow(unreachable_patterns)]
+        pub fn biz_label(&self) -> Option<&'static str> {
+            match self.biz {
+                17 => Some("RUNNING"),
+                19..=24 => Some("RUNNING"),
+                -144 => Some("RUNNING"),
+                202 => Some("STOPPED"),
+                18 => Some("WAITING"),
+                -32..=-25 => Some("WAITING"),
+                _ => None,
+            }
+        }
+
+        /// Label of the `baz` value, if any
+        #[allow(unreachable_patterns)]
+        pub fn baz_label(&self) -> Option<&'static str> {
+            match self.baz {
+                15 => Some("on/off"),
+                200..=1000 => Some("on/off"),
+                18 => Some("steam-machine"),
+                2 => Some("the-prime-time-of-your-life"),
+                _ => None,
+            }
+        }
+    }
+
+    /// `floats` event record, specific context and payload
+    #[derive(Clone, PartialEq, Debug)]
+    pub struct Floats {
+        pub f32: f32,
+        pub f64: f64,
+    }
+
+    impl Floats {
+        pub const ID: u64 = 2;
+        pub const NAME: &'static str = "floats";
+
+        #[inline]
+        pub fn decode(r: &mut EventReader<'_>) -> Result<Self, Error> {
+            r.align::<8>()?;
+            let f32 = r.f32_le::<4>()?;
+            let f64 = r.f64_le::<8>()?;
+            Ok(Self {
+                f32,
+                f64,
+            })
+        }
+    }
+
+    /// `foobar` event record, specific context and payload
+    #[derive(Clone, PartialEq, Debug)]
+    pub struct Foobar {
+        pub val: u32,
+        pub val2: u16,
+    }
+
+    impl Foobar {
+        pub const ID: u64 = 3;
+        pub const NAME: &'static str = "foobar";
+
+        #[inline]
+        pub fn decode(r: &mut EventReader<'_>) -> Result<Self, Error> {
+            r.align::<1>()?;
+            let val = r.u32_le::<1>()?;
+            let val2 = r.u16_le::<1>()?;
+            Ok(Self {
+                val,
+                val2,
+            })
+        }
+    }
+
+    /// `init` event record, specific context and payload
+    #[derive(Clone, PartialEq, Debug)]
+    pub struct Init<'a> {
+        pub cpu_id: i32,
+        pub version: Cow<'a, str>,
+    }
+
+    impl<'a> Init<'a> {
+        pub const ID: u64 = 4;
+        pub const NAME: &'static str = "init";
+
+        #[inline]
+        pub fn decode(r: &mut EventReader<'a>) -> Result<Self, Error> {
+            r.align::<4>()?;
+            let cpu_id = r.i32_le::<4>()?;
+            r.align::<1>()?;
+            let version = r.str()?;
+            Ok(Self {
+                cpu_id,
+                version,
+            })
+        }
+    }
+
+    /// `shutdown` event record, specific context and payload
+    #[derive(Clone, PartialEq, Debug)]
+    pub struct Shutdown {}
+
+    impl Shutdown {
+        pub const ID: u64 = 5;
+        pub const NAME: &'static str = "shutdown";
+
+        #[inline]
+        pub fn decode(r: &mut EventReader<'_>) -> Result<Self, Error> {
+            Ok(Self {})
+        }
+    }
+
+    #[derive(Clone, PartialEq, Debug)]
+    pub enum Event<'a> {
+        Arrays(Arrays<'a>),
+        Enums(Enums),
+        Floats(Floats),
+        Foobar(Foobar),
+        Init(Init<'a>),
+        Shutdown(Shutdown),
+    }
+
+    impl<'a> Event<'a> {
+        pub fn id(&self) -> u64 {
+            match self {
+                Self::Arrays(_) => Arrays::ID,
+                Self::Enums(_) => Enums::ID,
+                Self::Floats(_) => Floats::ID,
+                Self::Foobar(_) => Foobar::ID,
+                Self::Init(_) => Init::ID,
+                Self::Shutdown(_) => Shutdown::ID,
+            }
+        }
+
+        pub fn name(&self) -> &'static str {
+            match self {
+                Self::Arrays(_) => Arrays::NAME,
+                Self::Enums(_) => Enums::NAME,
+                Self::Floats(_) => Floats::NAME,
+                Self::Foobar(_) => Foobar::NAME,
+                Self::Init(_) => Init::NAME,
+                Self::Shutdown(_) => Shutdown::NAME,
+            }
+        }
+    }
+
+    /// A decoded event record
+    #[derive(Clone, PartialEq, Debug)]
+    pub struct Record<'a> {
+        pub timestamp: u64,
+        pub common_context: CommonContext,
+        pub event: Event<'a>,
+    }
+
+    /// Decode the next event record of a packet
+    #[inline]
+    pub fn decode_event<'a>(r: &mut EventReader<'a>) -> Result<Record<'a>, Error> {
+        r.align::<8>()?;
+        let id = u64::from(r.u16_le::<1>()?);
+        let timestamp = u64::from(r.u64_le::<8>()?);
+        let common_context = CommonContext::decode(r)?;
+        let event = match id {
+            0 => Event::Arrays(Arrays::decode(r)?),
+            1 => Event::Enums(Enums::decode(r)?),
+            2 => Event::Floats(Floats::decode(r)?),
+            3 => Event::Foobar(Foobar::decode(r)?),
+            4 => Event::Init(Init::decode(r)?),
+            5 => Event::Shutdown(Shutdown::decode(r)?),
+            _ => return Err(Error::UndefinedEventId(id)),
+        };
+        Ok(Record {
+            timestamp,
+            common_context,
+            event,
+        })
+    }
+}
@@ -1,6 +1,8 @@
 use barectf_parser::*;
+use bytes::BytesMut;
 use internment::Intern;
 use pretty_assertions::assert_eq;
+use std::io;
 use test_log::test;
 use tokio_stream::StreamExt;
 use tokio_util::codec::FramedRead;
@@ -38,6 +40,280 @@ fn full_trace_sync() {
     check_packet_context(&pkt1.context, 672, 5, 5, 1);
     check_event_5(pkt1.events.first());
     assert!(pkt1.events.get(1).is_none());
+
+    let stats = parser.stream_stats(pkt0.header.stream_id).unwrap();
+    assert_eq!(
+        stats,
+        StreamStats {
+            packets: 2,
+            missing_packets: 0,
+            out_of_order_packets: 0,
+            discarded_events: 0,
+            packets_with_discarded_events: 0,
+            max_discarded_events_delta: 0,
+        }
+    );
+    assert_eq!(
+        parser.counters(),
+        DecodeCounters {
+            packets: 2,
+            events: 6,
+            bytes: 512,
+            padding_bytes: 187,
+            skipped_bytes: 0,
+            // The end of the stream isn't an error
+            errors: Default::default(),
+        }
+    );
+
+    // Input ending mid-packet is
+    let trace = std::fs::read(STREAM).unwrap();
+    assert!(parser.parse(&mut &trace[..1]).is_err());
+    assert!(parser.parse(&mut &trace[..trace.len() / 2 - 1]).is_err());
+    assert_eq!(parser.counters().errors.unexpected_eof, 2);
+}
+
+#[test]
+fn full_trace_string_cache() {
+    let cfg = config();
+    let parser = Parser::new(&cfg).unwrap();
+    let cached_parser = Parser::new(&cfg).unwrap().with_string_cache(64);
+    let mut stream = std::fs::File::open(STREAM).unwrap();
+    let mut cached_stream = std::fs::File::open(STREAM).unwrap();
+
+    for _ in 0..2 {
+        let pkt = parser.parse(&mut stream).unwrap();
+        let cached_pkt = cached_parser.parse(&mut cached_stream).unwrap();
+        assert_eq!(pkt, cached_pkt);
+    }
+}
+
+#[test]
+fn full_trace_profile() {
+    let cfg = config();
+    let parser = Parser::new(&cfg).unwrap().with_profiling();
+    let mut stream = std::fs::File::open(STREAM).unwrap();
+    let mut content_bits = 0;
+    for _ in 0..2 {
+        content_bits += parser.parse(&mut stream).unwrap().context.content_size_bits;
+    }
+
+    let profile = parser.profile();
+    assert_eq!(
+        profile.iter().map(|p| p.schema.name()).collect::<Vec<_>>(),
+        parser
+            .event_schemas()
+            .into_iter()
+            .map(|(_, s)| s.name())
+            .collect::<Vec<_>>()
+    );
+    assert!(profile.iter().all(|p| p.events == 1));
+    assert!(profile
+        .iter()
+        .all(|p| p.histogram.iter().sum::<u64>() == p.events));
+    // Everything but the packet preambles
+    let event_bits: u64 = profile.iter().map(|p| p.bits).sum();
+    assert!(event_bits > 0 && event_bits < content_bits as u64);
+
+    assert!(Parser::new(&cfg).unwrap().profile().is_empty());
+}
+
+#[test]
+fn full_trace_clock_conversion() {
+    let cfg = config();
+    let parser = Parser::new(&cfg).unwrap();
+    let mut stream = std::fs::File::open(STREAM).unwrap();
+    let pkt = parser.parse(&mut stream).unwrap();
+
+    // 1 GHz clock without offset
+    let clock = parser.clock_converter(pkt.header.stream_id).unwrap();
+    assert!(!clock.origin_is_unix_epoch());
+    let mut timestamps: Vec<Timestamp> = pkt.events.iter().map(|e| e.timestamp).collect();
+    clock.to_nanos_in_place(&mut timestamps);
+    assert_eq!(timestamps, vec![0, 1, 2, 3, 4]);
+    assert!(parser.clock_converter(1).is_none());
+}
+
+#[test]
+fn full_trace_serde() {
+    let cfg = config();
+    let parser = Parser::new(&cfg).unwrap();
+    let mut stream = std::fs::File::open(STREAM).unwrap();
+    let pkt = parser.parse(&mut stream).unwrap();
+
+    // Members by name, not the schemas with their enumeration mappings
+    let json = serde_json::to_string(&pkt).unwrap();
+    assert!(!json.contains("enum_mappings"));
+    assert!(!json.contains("preferred_display_base"));
+
+    let de: Packet = serde_json::from_str(&json).unwrap();
+    assert_eq!(de.header, pkt.header);
+    assert_eq!(de.events.len(), pkt.events.len());
+    for (a, b) in de.events.iter().zip(pkt.events.iter()) {
+        assert_eq!(a.id(), b.id());
+        assert_eq!(a.name(), b.name());
+        assert_eq!(a.log_level(), b.log_level());
+        assert_eq!(a.timestamp, b.timestamp);
+        assert_eq!(a.values, b.values);
+        assert_eq!(a.schema.common_context(), b.schema.common_context());
+        assert_eq!(a.schema.payload(), b.schema.payload());
+        let names = |e: &Event| -> Vec<_> { e.schema.members().iter().map(|m| m.name).collect() };
+        assert_eq!(names(a), names(b));
+    }
+    let names = |c: &PacketContext| -> Vec<_> {
+        c.extra_members
+            .iter()
+            .map(|(m, v)| (m.name, v.clone()))
+            .collect()
+    };
+    assert_eq!(names(&de.context), names(&pkt.context));
+}
+
+#[test]
+fn full_trace_visitor() {
+    let cfg = config();
+    let parser = Parser::new(&cfg).unwrap();
+    let mut stream = std::fs::File::open(STREAM).unwrap();
+    let mut visited_stream = std::fs::File::open(STREAM).unwrap();
+    let trace = std::fs::read(STREAM).unwrap();
+    let mut offset = 0;
+
+    for _ in 0..2 {
+        let pkt = parser.parse(&mut stream).unwrap();
+        let mut visitor = Recorder::default();
+        parser.visit(&mut visited_stream, &mut visitor).unwrap();
+
+        // Event sizes cover the packet content following the preamble
+        let (_, _, preamble_bytes) = parser.parse_packet_preamble(&trace[offset..]).unwrap();
+        assert_eq!(
+            visitor.event_bits,
+            pkt.context.content_size_bits - preamble_bytes * 8
+        );
+        offset += pkt.context.packet_size();
+
+        assert_eq!(visitor.header, Some(pkt.header));
+        assert_eq!(visitor.context, Some(pkt.context));
+        let events = pkt
+            .events
+            .iter()
+            .map(|e| {
+                let mut values = Vec::new();
+                for (s, v) in e
+                    .common_context()
+                    .chain(e.specific_context())
+                    .chain(e.payload())
+                {
+                    let name = s.name.as_str().to_owned();
+                    match v {
+                        FieldValue::Primitive(v) => values.push((name, Visited::from(v))),
+                        FieldValue::Array(arr) => {
+                            values.push((name.clone(), Visited::ArrayBegin(arr.len())));
+                            for i in 0..arr.len() {
+                                values.push((name.clone(), Visited::from(&arr.get(i).unwrap())));
+                            }
+                            values.push((name, Visited::ArrayEnd));
+                        }
+                    }
+                }
+                (e.name().as_str().to_owned(), e.timestamp, values)
+            })
+            .collect::<Vec<_>>();
+        assert_eq!(visitor.events, events);
+        assert!(visitor.packet_ended);
+    }
+}
+
+#[derive(Debug, PartialEq)]
+enum Visited {
+    U64(u64),
+    I64(i64),
+    F64(f64),
+    Enum(i64),
+    Str(String),
+    ArrayBegin(usize),
+    ArrayEnd,
+}
+
+impl From<&PrimitiveFieldValue> for Visited {
+    fn from(v: &PrimitiveFieldValue) -> Self {
+        match v {
+            PrimitiveFieldValue::UnsignedInteger(v) => Self::U64(*v),
+            PrimitiveFieldValue::SignedInteger(v) => Self::I64(*v),
+            PrimitiveFieldValue::String(v) => Self::Str(v.to_string()),
+            PrimitiveFieldValue::F32(v) => Self::F64(v.into_inner().into()),
+            PrimitiveFieldValue::F64(v) => Self::F64(v.into_inner()),
+            PrimitiveFieldValue::Enumeration(v) => Self::Enum(*v),
+        }
+    }
+}
+
+type VisitedEvent = (String, Timestamp, Vec<(String, Visited)>);
+
+#[derive(Default)]
+struct Recorder {
+    header: Option<PacketHeader>,
+    context: Option<PacketContext>,
+    events: Vec<VisitedEvent>,
+    event_bits: usize,
+    packet_ended: bool,
+}
+
+impl Recorder {
+    fn push(&mut self, member: &FieldSchema, v: Visited) {
+        let event = self.events.last_mut().unwrap();
+        event.2.push((member.name.as_str().to_owned(), v));
+    }
+}
+
+impl EventVisitor for Recorder {
+    fn on_packet_header(&mut self, header: &PacketHeader) {
+        self.header = Some(*header);
+    }
+
+    fn on_packet_context(&mut self, context: &PacketContext) {
+        self.context = Some(context.clone());
+    }
+
+    fn on_event_begin(&mut self, schema: &EventSchema, timestamp: Timestamp) {
+        self.events
+            .push((schema.name().as_str().to_owned(), timestamp, Vec::new()));
+    }
+
+    fn on_u64(&mut self, member: &FieldSchema, v: u64) {
+        self.push(member, Visited::U64(v));
+    }
+
+    fn on_i64(&mut self, member: &FieldSchema, v: i64) {
+        self.push(member, Visited::I64(v));
+    }
+
+    fn on_f64(&mut self, member: &FieldSchema, v: f64) {
+        self.push(member, Visited::F64(v));
+    }
+
+    fn on_enum(&mut self, member: &FieldSchema, v: i64) {
+        self.push(member, Visited::Enum(v));
+    }
+
+    fn on_str(&mut self, member: &FieldSchema, v: &str) {
+        self.push(member, Visited::Str(v.to_owned()));
+    }
+
+    fn on_array_begin(&mut self, member: &FieldSchema, len: usize) {
+        self.push(member, Visited::ArrayBegin(len));
+    }
+
+    fn on_array_end(&mut self, member: &FieldSchema) {
+        self.push(member, Visited::ArrayEnd);
+    }
+
+    fn on_event_size(&mut self, bits: usize) {
+        self.event_bits += bits;
+    }
+
+    fn on_packet_end(&mut self) {
+        self.packet_ended = true;
+    }
 }
 
 #[test(tokio::test)]
@@ -68,6 +344,621 @@ async fn full_trace_async() {
     assert!(pkt1.events.get(1).is_none());
 }
 
+#[test(tokio::test)]
+async fn full_trace_resync() {
+    let cfg = config();
+    let parser = Parser::new(&cfg).unwrap();
+    let trace = std::fs::read(STREAM).unwrap();
+    let (pkt0, pkt1) = trace.split_at(trace.len() / 2);
+    let mut bad_magic_pkt1 = pkt1.to_vec();
+    bad_magic_pkt1[0] ^= 0xFF;
+
+    // Leading partial magic number, a torn packet, padding, a corrupt header
+    // and a trailing torn packet around the good packets
+    let corrupt = [
+        &[0xC1, 0x1F, 0x00, 0x42][..],
+        &pkt0[..48],
+        pkt0,
+        &[0xAA; 3],
+        &bad_magic_pkt1,
+        pkt1,
+        &pkt0[..20],
+    ]
+    .concat();
+
+    let decoder = parser.into_packet_decoder().with_resync();
+    let mut reader = FramedRead::new(corrupt.as_slice(), decoder);
+
+    let pkt0 = reader.next().await.unwrap().unwrap();
+    let pkt1 = reader.next().await.unwrap().unwrap();
+    let next = reader.next().await;
+    assert!(next.is_none());
+    assert_eq!(
+        reader.decoder().skipped_bytes(),
+        (corrupt.len() - trace.len()) as u64
+    );
+    let counters = reader.decoder().counters();
+    assert_eq!(counters.packets, 2);
+    assert_eq!(counters.skipped_bytes, reader.decoder().skipped_bytes());
+    assert!(counters.errors.unexpected_eof > 0); // Trailing torn packet
+
+    check_packet_context(&pkt0.context, 1928, 0, 5, 0);
+    check_event_0(pkt0.events.first());
+    check_event_4(pkt0.events.get(4));
+    check_packet_context(&pkt1.context, 672, 5, 5, 1);
+    check_event_5(pkt1.events.first());
+}
+
+#[test]
+fn full_trace_resync_max_packet_size() {
+    use tokio_util::codec::Decoder;
+
+    let cfg = config();
+    let trace = std::fs::read(STREAM).unwrap();
+    let (pkt0, pkt1) = trace.split_at(trace.len() / 2);
+    // 16 bit packet size field at byte 24, 8191 bytes instead of 256
+    let mut bad_size_pkt0 = pkt0.to_vec();
+    bad_size_pkt0[24..26].copy_from_slice(&65528_u16.to_le_bytes());
+    let corrupt = [&bad_size_pkt0, pkt0, pkt1].concat();
+
+    let mut decoder = Parser::new(&cfg)
+        .unwrap()
+        .into_packet_decoder()
+        .with_resync()
+        .with_max_packet_size(1024);
+    // Rejected without waiting for the end of the input
+    let mut src = BytesMut::from(corrupt.as_slice());
+    let pkt = decoder.decode(&mut src).unwrap().unwrap();
+    check_packet_context(&pkt.context, 1928, 0, 5, 0);
+    let pkt = decoder.decode(&mut src).unwrap().unwrap();
+    check_packet_context(&pkt.context, 672, 5, 5, 1);
+    assert!(src.is_empty());
+    assert_eq!(decoder.skipped_bytes(), pkt0.len() as u64);
+    assert_eq!(decoder.counters().errors.invalid_packet, 1);
+
+    // Buffered until the end of the input otherwise
+    let mut decoder = Parser::new(&cfg)
+        .unwrap()
+        .into_packet_decoder()
+        .with_resync();
+    let mut src = BytesMut::from(corrupt.as_slice());
+    assert!(decoder.decode(&mut src).unwrap().is_none());
+}
+
+#[test]
+fn oversized_packet_size() {
+    let mut cfg = config();
+    let stream = cfg.trace.typ.data_stream_types.get_mut("default").unwrap();
+    let ft = &mut stream.features.packet.total_size_field_type.field_type;
+    ft.size = 32;
+    ft.alignment = 32;
+    let mut w = PacketWriter::new(&cfg, 256, Vec::new()).unwrap();
+    let (stream_id, schema) = w.parser().event_schemas()[0];
+    let values = w.synthetic_values(stream_id, schema.id(), 0).unwrap();
+    w.write_event(stream_id, schema.id(), 0, &values).unwrap();
+    let mut trace = w.into_inner().unwrap();
+
+    // 32 bit packet size field at byte 24
+    assert_eq!(trace[24..28], (256_u32 * 8).to_le_bytes());
+    trace[24..28].copy_from_slice(&u32::MAX.to_le_bytes());
+
+    // Rejected before reading, or allocating, the rest of the packet
+    let parser = Parser::new(&cfg).unwrap();
+    assert!(matches!(
+        parser.parse(&mut trace.as_slice()),
+        Err(Error::InvalidPacketSize(bits, _)) if bits == u32::MAX as usize
+    ));
+    struct Nop;
+    impl EventVisitor for Nop {}
+    assert!(matches!(
+        parser.visit(&mut trace.as_slice(), &mut Nop),
+        Err(Error::InvalidPacketSize(_, _))
+    ));
+    assert_eq!(parser.counters().errors.invalid_packet, 2);
+}
+
+#[test]
+fn zero_packet_size() {
+    use tokio_util::codec::Decoder;
+
+    let cfg = config();
+    let mut trace = std::fs::read(STREAM).unwrap();
+    // 16 bit packet size field at byte 24
+    trace[24..26].copy_from_slice(&0_u16.to_le_bytes());
+
+    let parser = Parser::new(&cfg).unwrap();
+    assert!(matches!(
+        parser.parse(&mut trace.as_slice()),
+        Err(Error::InvalidPacketSize(0, 1928))
+    ));
+    struct Nop;
+    impl EventVisitor for Nop {}
+    assert!(matches!(
+        parser.visit(&mut trace.as_slice(), &mut Nop),
+        Err(Error::InvalidPacketSize(0, 1928))
+    ));
+    assert!(matches!(
+        parser.parse_packet_preamble(&trace),
+        Err(Error::InvalidPacketSize(0, 1928))
+    ));
+
+    let mut decoder = Parser::new(&cfg).unwrap().into_packet_decoder();
+    let mut src = BytesMut::from(trace.as_slice());
+    assert!(matches!(
+        decoder.decode(&mut src),
+        Err(Error::InvalidPacketSize(0, 1928))
+    ));
+    assert_eq!(decoder.counters().errors.invalid_packet, 1);
+}
+
+#[cfg(feature = "zstd")]
+#[test(tokio::test)]
+async fn full_trace_zstd() {
+    let cfg = config();
+    let trace = std::fs::read(STREAM).unwrap();
+    let compressed = zstd::encode_all(trace.as_slice(), 3).unwrap();
+    assert_eq!(Compression::detect(&compressed), Compression::Zstd);
+
+    let parser = Parser::new(&cfg).unwrap();
+    let mut stream = DecompressReader::new(io::Cursor::new(compressed.clone()));
+    let pkt0 = parser.parse(&mut stream).unwrap();
+    let pkt1 = parser.parse(&mut stream).unwrap();
+    assert!(parser.parse(&mut stream).is_err()); // EOF
+    check_event_0(pkt0.events.first());
+    check_event_5(pkt1.events.first());
+
+    let decoder = Parser::new(&cfg).unwrap().into_packet_decoder();
+    let stream = AsyncDecompressReader::new(io::Cursor::new(compressed));
+    let mut reader = FramedRead::new(stream, decoder);
+    assert_eq!(reader.next().await.unwrap().unwrap(), pkt0);
+    assert_eq!(reader.next().await.unwrap().unwrap(), pkt1);
+    assert!(reader.next().await.is_none());
+}
+
+#[cfg(feature = "zstd")]
+#[test]
+fn full_trace_archive() {
+    let cfg = config();
+    let parser = Parser::new(&cfg).unwrap();
+    let trace = std::fs::read(STREAM).unwrap();
+    let (pkt0, pkt1) = trace.split_at(trace.len() / 2);
+
+    // One packet per frame
+    let mut archive = ArchiveWriter::new(Vec::new()).with_frame_size(pkt0.len());
+    assert_eq!(parser.archive(trace.as_slice(), &mut archive).unwrap(), 2);
+    let archive = archive.finish().unwrap();
+
+    let mut reader = ArchiveReader::open(io::Cursor::new(archive)).unwrap();
+    let index = reader.index().to_vec();
+    assert_eq!(index.len(), 2);
+    for (frame, seq, ts) in [(&index[0], 0, 0..=5), (&index[1], 1, 5..=5)] {
+        assert_eq!(frame.stream_id, 0);
+        assert_eq!(frame.packets, 1);
+        assert_eq!(frame.size, pkt0.len() as u64);
+        assert_eq!(frame.sequence_numbers, Some(seq..=seq));
+        assert_eq!(frame.timestamps, Some(ts));
+    }
+    assert_eq!(reader.read_frame(1).unwrap(), pkt1);
+
+    let mut extract = |filter: PacketFilter| {
+        let mut out = Vec::new();
+        let summary = reader.extract(&parser, &filter, &mut out).unwrap();
+        assert_eq!(summary.bytes_written, out.len() as u64);
+        (summary.packets_read, out)
+    };
+    assert_eq!(extract(PacketFilter::default()), (2, trace.clone()));
+    // Only the overlapping frames are decompressed
+    assert_eq!(
+        extract(PacketFilter {
+            sequence_numbers: Some(1..=1),
+            ..Default::default()
+        }),
+        (1, pkt1.to_vec())
+    );
+    assert_eq!(
+        extract(PacketFilter {
+            timestamps: Some(0..=4),
+            ..Default::default()
+        }),
+        (1, pkt0.to_vec())
+    );
+    assert_eq!(
+        extract(PacketFilter {
+            streams: Some(vec![1]),
+            ..Default::default()
+        }),
+        (0, Vec::new())
+    );
+
+    // Both packets in one frame
+    let mut archive = ArchiveWriter::new(Vec::new());
+    parser.archive(trace.as_slice(), &mut archive).unwrap();
+    let mut reader = ArchiveReader::open(io::Cursor::new(archive.finish().unwrap())).unwrap();
+    assert_eq!(reader.index().len(), 1);
+    assert_eq!(reader.index()[0].sequence_numbers, Some(0..=1));
+    assert_eq!(reader.index()[0].timestamps, Some(0..=5));
+    let mut out = Vec::new();
+    let summary = reader
+        .extract(
+            &parser,
+            &PacketFilter {
+                sequence_numbers: Some(1..=1),
+                ..Default::default()
+            },
+            &mut out,
+        )
+        .unwrap();
+    assert_eq!(summary.packets_read, 2);
+    assert_eq!(out, pkt1);
+}
+
+/// A trace of the `full` schema with `bits` wide event timestamps, a third of a
+/// rollover apart from `base`, in 256 byte packets.
+/// Returns its configuration, the trace and the event timestamps.
+fn narrow_timestamp_trace(
+    bits: usize,
+    beginning_timestamps: bool,
+    base: Timestamp,
+) -> (Config, Vec<u8>, Vec<Timestamp>) {
+    let mut cfg = config();
+    let stream = cfg.trace.typ.data_stream_types.get_mut("default").unwrap();
+    let ft = &mut stream.features.event_record.timestamp_field_type.field_type;
+    ft.size = bits;
+    ft.alignment = 8;
+    if !beginning_timestamps {
+        stream.features.packet.beginning_timestamp_field_type =
+            FeaturesUnsignedIntegerFieldType::False(false);
+    }
+
+    let mut w = PacketWriter::new(&cfg, 256, Vec::new()).unwrap();
+    let (stream_id, schema) = w.parser().event_schemas()[0];
+    let step = (1 << bits) / 3 + 1;
+    let timestamps: Vec<Timestamp> = (0..64).map(|i| base + i * step).collect();
+    for (i, ts) in timestamps.iter().enumerate() {
+        let values = w
+            .synthetic_values(stream_id, schema.id(), i as u64)
+            .unwrap();
+        w.write_event(stream_id, schema.id(), *ts, &values).unwrap();
+    }
+    let trace = w.into_inner().unwrap();
+    assert!(trace.len() > 2 * 256);
+    (cfg, trace, timestamps)
+}
+
+async fn decoded_timestamps(cfg: &Config, trace: &[u8]) -> Vec<Timestamp> {
+    let decoder = Parser::new(cfg).unwrap().into_packet_decoder();
+    let mut reader = FramedRead::new(trace, decoder);
+    let mut timestamps = Vec::new();
+    while let Some(pkt) = reader.next().await {
+        timestamps.extend(pkt.unwrap().events.iter().map(|e| e.timestamp));
+    }
+    timestamps
+}
+
+#[test(tokio::test)]
+async fn narrow_timestamps_carried_over() {
+    for bits in [8, 16, 32] {
+        // Rollovers within and between packets, without beginning timestamps
+        let (cfg, trace, expected) = narrow_timestamp_trace(bits, false, 0);
+        assert_eq!(
+            decoded_timestamps(&cfg, &trace).await,
+            expected,
+            "{bits} bits"
+        );
+
+        // Decoders track their own input
+        let decoder = Parser::new(&cfg).unwrap().into_packet_decoder();
+        let mut a = FramedRead::new(trace.as_slice(), decoder);
+        let first = a.next().await.unwrap().unwrap();
+        assert_eq!(
+            decoded_timestamps(&cfg, &trace).await,
+            expected,
+            "{bits} bits"
+        );
+        let second = a.next().await.unwrap().unwrap();
+        let decoded: Vec<_> = first
+            .events
+            .iter()
+            .chain(second.events.iter())
+            .map(|e| e.timestamp)
+            .collect();
+        assert_eq!(decoded, expected[..decoded.len()], "{bits} bits");
+    }
+}
+
+#[test(tokio::test)]
+async fn narrow_timestamps_reseeded() {
+    for bits in [8, 16, 32] {
+        // Seeded from the 64 bit packet beginning timestamps
+        let (cfg, trace, expected) = narrow_timestamp_trace(bits, true, (1 << 40) + 3);
+        assert_eq!(
+            decoded_timestamps(&cfg, &trace).await,
+            expected,
+            "{bits} bits"
+        );
+
+        // Packets decoded on their own, in any order
+        let parser = Parser::new(&cfg).unwrap();
+        let mut decoded: Vec<Vec<Timestamp>> = trace
+            .chunks(256)
+            .rev()
+            .map(|mut pkt| {
+                let pkt = parser.parse(&mut pkt).unwrap();
+                pkt.events.iter().map(|e| e.timestamp).collect()
+            })
+            .collect();
+        decoded.reverse();
+        assert_eq!(decoded.concat(), expected, "{bits} bits");
+    }
+}
+
+#[test]
+fn full_trace_parallel() {
+    let cfg = config();
+    let parser = Parser::new(&cfg).unwrap();
+    let trace = std::fs::read(STREAM).unwrap();
+    let pkt_size = trace.len() / 2;
+    let data = trace.repeat(8);
+
+    let boundaries = parser.chunk_boundaries(&data, 4);
+    assert_eq!(boundaries.len(), 4);
+    assert!(boundaries.iter().all(|b| b % pkt_size == 0));
+
+    let mut stream = data.as_slice();
+    let mut expected = Vec::new();
+    while !stream.is_empty() {
+        expected.push(parser.parse(&mut stream).unwrap());
+    }
+    assert_eq!(expected.len(), 16);
+    assert_eq!(parser.parse_parallel(&data, 4).unwrap(), expected);
+    assert_eq!(parser.parse_parallel(&data, 1).unwrap(), expected);
+    assert_eq!(parser.parse_parallel(&data, 64).unwrap(), expected);
+    assert_eq!(parser.counters().packets, 4 * 16);
+}
+
+#[test]
+fn full_trace_parallel_false_boundary() {
+    let cfg = config();
+    let parser = Parser::new(&cfg).unwrap();
+    let trace = std::fs::read(STREAM).unwrap();
+    let pkt_size = trace.len() / 2;
+    let (_, _, preamble_size) = parser.parse_packet_preamble(&trace[pkt_size..]).unwrap();
+
+    // A packet preamble planted in the padding of the second packet (84 bytes of
+    // content), sized to end on the next packet's start
+    let fake_offset = 128;
+    let mut fake = trace[pkt_size..pkt_size + preamble_size].to_vec();
+    fake[24..26].copy_from_slice(&(((pkt_size - fake_offset) * 8) as u16).to_le_bytes());
+    fake[26..28].copy_from_slice(&((preamble_size * 8) as u16).to_le_bytes());
+    let mut trace = trace;
+    trace[pkt_size + fake_offset..pkt_size + fake_offset + preamble_size].copy_from_slice(&fake);
+    let data = trace.repeat(8);
+
+    // Splitting at 1365, within the padding of the 6th packet ahead of the planted preamble
+    let boundaries = parser.chunk_boundaries(&data, 3);
+    assert_eq!(boundaries[1], 5 * pkt_size + fake_offset);
+
+    let mut stream = data.as_slice();
+    let mut expected = Vec::new();
+    while !stream.is_empty() {
+        expected.push(parser.parse(&mut stream).unwrap());
+    }
+    assert_eq!(expected.len(), 16);
+    assert!(matches!(
+        parser.parse_parallel(&data, 3),
+        Err(Error::InvalidPacketSize(_, _))
+    ));
+    assert_eq!(parser.parse_parallel(&data, 1).unwrap(), expected);
+}
+
+#[test]
+fn full_trace_slice() {
+    let cfg = config();
+    let parser = Parser::new(&cfg).unwrap();
+    let trace = std::fs::read(STREAM).unwrap();
+    let (pkt0, pkt1) = trace.split_at(trace.len() / 2);
+
+    let slice = |filter: PacketFilter| {
+        let mut out = Vec::new();
+        let summary = parser.slice(trace.as_slice(), &mut out, &filter).unwrap();
+        assert_eq!(summary.packets_read, 2);
+        assert_eq!(summary.bytes_written, out.len() as u64);
+        out
+    };
+
+    assert_eq!(slice(PacketFilter::default()), trace);
+    assert_eq!(
+        slice(PacketFilter {
+            sequence_numbers: Some(1..=1),
+            ..Default::default()
+        }),
+        pkt1
+    );
+    assert!(slice(PacketFilter {
+        streams: Some(vec![1]),
+        ..Default::default()
+    })
+    .is_empty());
+    // Packet timestamps, 0..=5 and 5..=5
+    assert_eq!(
+        slice(PacketFilter {
+            timestamps: Some(0..=4),
+            ..Default::default()
+        }),
+        pkt0
+    );
+    assert_eq!(
+        slice(PacketFilter {
+            timestamps: Some(5..=10),
+            ..Default::default()
+        }),
+        trace
+    );
+
+    // Torn packet
+    let err = parser.slice(&trace[..300], io::sink(), &PacketFilter::default());
+    assert!(matches!(err, Err(Error::Io(e)) if e.kind() == io::ErrorKind::UnexpectedEof));
+}
+
+#[test]
+fn full_trace_round_trip() {
+    let cfg = config();
+    let parser = Parser::new(&cfg).unwrap();
+    let mut stream = std::fs::File::open(STREAM).unwrap();
+    let pkts = [
+        parser.parse(&mut stream).unwrap(),
+        parser.parse(&mut stream).unwrap(),
+    ];
+    let stream_id = pkts[0].header.stream_id;
+
+    let mut w = PacketWriter::new(&cfg, 256, Vec::new()).unwrap();
+    let extra_members = pkts[0].context.extra_members.iter();
+    w.set_extra_members(stream_id, extra_members.map(|(_, v)| v.clone()).collect())
+        .unwrap();
+    for e in pkts.iter().flat_map(|p| &p.events) {
+        w.write_event(stream_id, e.id(), e.timestamp, &e.values)
+            .unwrap();
+    }
+    let trace = w.into_inner().unwrap();
+    assert_eq!(trace.len() % 256, 0);
+
+    let parser = Parser::new(&cfg).unwrap();
+    let mut src = trace.as_slice();
+    let mut events = Vec::new();
+    while !src.is_empty() {
+        let pkt = parser.parse(&mut src).unwrap();
+        check_packet_header(&pkt.header);
+        assert_eq!(pkt.context.extra_members, pkts[0].context.extra_members);
+        events.extend(pkt.events);
+    }
+    let expected: Vec<Event> = pkts.into_iter().flat_map(|p| p.events).collect();
+    assert_eq!(events, expected);
+}
+
+#[test]
+fn packet_writer_size_limits() {
+    let cfg = config();
+    // 16 bit packet size field
+    assert!(PacketWriter::new(&cfg, 8191, Vec::new()).is_ok());
+    assert!(matches!(
+        PacketWriter::new(&cfg, 8192, Vec::new()),
+        Err(Error::InvalidPacketSize(65536, 65536))
+    ));
+    assert!(matches!(
+        PacketWriter::new(&cfg, 16384, Vec::new()),
+        Err(Error::InvalidPacketSize(_, _))
+    ));
+}
+
+#[test]
+fn packet_writer_unencodable_values() {
+    let cfg = config();
+    let mut w = PacketWriter::new(&cfg, 256, Vec::new()).unwrap();
+    let schema = |w: &PacketWriter<Vec<u8>>, name: &str| {
+        w.parser()
+            .event_schemas()
+            .into_iter()
+            .find(|(_, s)| s.name().as_str() == name)
+            .unwrap()
+            .1
+    };
+    let mut write = |name: &str, index: usize, value: FieldValue| {
+        let schema = schema(&w, name);
+        let mut values = w.synthetic_values(0, schema.id(), 1).unwrap();
+        values[index] = value;
+        w.write_event(0, schema.id(), 1, &values)
+    };
+    let uint = |v: u64| FieldValue::Primitive(PrimitiveFieldValue::UnsignedInteger(v));
+    let int = |v: i64| FieldValue::Primitive(PrimitiveFieldValue::SignedInteger(v));
+    let enumeration = |v: i64| FieldValue::Primitive(PrimitiveFieldValue::Enumeration(v));
+    let string = |s: &str| FieldValue::Primitive(PrimitiveFieldValue::String(s.into()));
+    let mismatched = |res: Result<(), Error>, member: &str| matches!(res, Err(Error::MismatchedFieldValue(m)) if m == member);
+
+    // Out of the field type range rather than truncated
+    assert!(mismatched(write("foobar", 2, uint(1 << 16)), "val2"));
+    assert!(mismatched(
+        write("init", 1, int(i64::from(i32::MAX) + 1)),
+        "cpu_id"
+    ));
+    assert!(mismatched(
+        write("init", 1, int(i64::from(i32::MIN) - 1)),
+        "cpu_id"
+    ));
+    assert!(mismatched(write("enums", 1, enumeration(256)), "foo"));
+    assert!(mismatched(write("enums", 1, enumeration(-1)), "foo"));
+    assert!(mismatched(write("enums", 2, enumeration(-32769)), "bar"));
+    // Interior NULs would end the strings early
+    assert!(mismatched(write("init", 2, string("v1\0v2")), "version"));
+    let strings = ArrayFieldValue::String(vec!["a".into(), "b\0".into()]);
+    assert!(mismatched(
+        write("arrays", 2, FieldValue::Array(strings)),
+        "bar"
+    ));
+
+    write("foobar", 2, uint(u16::MAX.into())).unwrap();
+    write("init", 1, int(i32::MIN.into())).unwrap();
+    write("enums", 2, enumeration(i16::MIN.into())).unwrap();
+    let trace = w.into_inner().unwrap();
+
+    // Only the valid events were written
+    let pkt = Parser::new(&cfg)
+        .unwrap()
+        .parse(&mut trace.as_slice())
+        .unwrap();
+    let names: Vec<_> = pkt.events.iter().map(|e| e.schema.name()).collect();
+    assert_eq!(
+        names,
+        ["foobar", "init", "enums"].map(|n| Intern::new(n.to_owned()))
+    );
+    assert_eq!(pkt.events[0].values[2], uint(u16::MAX.into()));
+    assert_eq!(pkt.events[1].values[1], int(i32::MIN.into()));
+    assert_eq!(pkt.events[2].values[2], enumeration(i16::MIN.into()));
+}
+
+#[test]
+fn synthetic_trace_big_endian() {
+    let mut cfg = config();
+    cfg.trace.typ.native_byte_order = NativeByteOrder::BigEndian;
+    let mut w = PacketWriter::new(&cfg, 256, Vec::new()).unwrap();
+
+    let schemas = w.parser().event_schemas();
+    let mut expected = Vec::new();
+    for i in 0..200 {
+        let (stream_id, schema) = schemas[i as usize % schemas.len()];
+        let values = w.synthetic_values(stream_id, schema.id(), i).unwrap();
+        w.write_event(stream_id, schema.id(), i * 1_000, &values)
+            .unwrap();
+        expected.push(Event {
+            schema,
+            timestamp: i * 1_000,
+            values,
+        });
+    }
+    w.discard_events(0, 3).unwrap();
+    let trace = w.into_inner().unwrap();
+
+    let parser = Parser::new(&cfg).unwrap();
+    let mut src = trace.as_slice();
+    let mut events = Vec::new();
+    while !src.is_empty() {
+        events.extend(parser.parse(&mut src).unwrap().events);
+    }
+    assert_eq!(events, expected);
+
+    let stats = parser.stream_stats(0).unwrap();
+    assert_eq!(stats.packets as usize, trace.len() / 256);
+    assert_eq!(stats.missing_packets, 0);
+    assert_eq!(stats.discarded_events, 3);
+
+    let parallel: Vec<Event> = parser
+        .parse_parallel(&trace, 4)
+        .unwrap()
+        .into_iter()
+        .flat_map(|p| p.events)
+        .collect();
+    assert_eq!(parallel, expected);
+}
+
 fn check_packet_header(h: &PacketHeader) {
     let uuid = Uuid::parse_str("79e49040-21b5-42d4-a83b-646f78666b62").unwrap();
     assert_eq!(
@@ -109,86 +1000,106 @@ fn check_packet_context(
             events_discarded: 0.into(),
             sequence_number: sn.into(),
             extra_members: vec![(
-                Intern::new("pc".to_owned()),
+                Intern::new(FieldSchema {
+                    name: Intern::new("pc".to_owned()),
+                    preferred_display_base: PreferredDisplayBase::Decimal.into(),
+                    enum_mappings: None,
+                }),
                 PrimitiveFieldValue::from(22_u32).into()
             )],
         }
     );
 }
 
+/// Event members by name, the member schemas are checked separately
+#[derive(Debug, PartialEq)]
+struct EventView<'a> {
+    id: EventId,
+    name: &'a str,
+    timestamp: Timestamp,
+    log_level: Option<LogLevel>,
+    common_context: Vec<(&'a str, FieldValue)>,
+    specific_context: Vec<(&'a str, FieldValue)>,
+    payload: Vec<(&'a str, FieldValue)>,
+}
+
+impl<'a> From<&'a Event> for EventView<'a> {
+    fn from(e: &'a Event) -> Self {
+        fn members<'a>(
+            m: impl Iterator<Item = (&'a FieldSchema, &'a FieldValue)>,
+        ) -> Vec<(&'a str, FieldValue)> {
+            m.map(|(s, v)| (s.name.as_str(), v.clone())).collect()
+        }
+        EventView {
+            id: e.id(),
+            name: e.name().as_ref().as_str(),
+            timestamp: e.timestamp,
+            log_level: e.log_level(),
+            common_context: members(e.common_context()),
+            specific_context: members(e.specific_context()),
+            payload: members(e.payload()),
+        }
+    }
+}
+
 fn check_event_0(e: Option<&Event>) {
     assert_eq!(
-        e,
-        Some(&Event {
+        e.map(EventView::from),
+        Some(EventView {
             id: 4,
-            name: Intern::new("init".to_owned()),
+            name: "init",
             timestamp: 0,
             log_level: None,
-            common_context: vec![(
-                Intern::new("ercc".to_owned()),
-                PrimitiveFieldValue::from(98_u32).into()
-            )],
-            specific_context: vec![(
-                Intern::new("cpu_id".to_owned()),
-                PrimitiveFieldValue::from(1_i32).into()
-            )],
-            payload: vec![(
-                Intern::new("version".to_owned()),
-                PrimitiveFieldValue::from("1.0.0").into()
-            )],
+            common_context: vec![("ercc", PrimitiveFieldValue::from(98_u32).into())],
+            specific_context: vec![("cpu_id", PrimitiveFieldValue::from(1_i32).into())],
+            payload: vec![("version", PrimitiveFieldValue::from("1.0.0").into())],
         })
     );
 }
 
 fn check_event_1(e: Option<&Event>) {
     assert_eq!(
-        e,
-        Some(&Event {
+        e.map(EventView::from),
+        Some(EventView {
             id: 3,
-            name: Intern::new("foobar".to_owned()),
+            name: "foobar",
             timestamp: 1,
             log_level: LogLevel::Critical.into(),
-            common_context: vec![(
-                Intern::new("ercc".to_owned()),
-                PrimitiveFieldValue::from(97_u32).into()
-            )],
+            common_context: vec![("ercc", PrimitiveFieldValue::from(97_u32).into())],
             specific_context: vec![],
             payload: vec![
-                (
-                    Intern::new("val".to_owned()),
-                    PrimitiveFieldValue::from(3_u32).into()
-                ),
-                (
-                    Intern::new("val2".to_owned()),
-                    PrimitiveFieldValue::from(21_u32).into()
-                ),
+                ("val", PrimitiveFieldValue::from(3_u32).into()),
+                ("val2", PrimitiveFieldValue::from(21_u32).into()),
             ],
         })
     );
+
+    // Positional lookup by name, across sections
+    let e = e.unwrap();
+    assert_eq!(
+        e.get("ercc"),
+        Some(&PrimitiveFieldValue::from(97_u32).into())
+    );
+    assert_eq!(
+        e.get("val2"),
+        Some(&PrimitiveFieldValue::from(21_u32).into())
+    );
+    assert_eq!(e.get("cpu_id"), None);
 }
 
 fn check_event_2(e: Option<&Event>) {
     assert_eq!(
-        e,
-        Some(&Event {
+        e.map(EventView::from),
+        Some(EventView {
             id: 2,
-            name: Intern::new("floats".to_owned()),
+            name: "floats",
             timestamp: 2,
             log_level: LogLevel::Warning.into(),
-            common_context: vec![(
-                Intern::new("ercc".to_owned()),
-                PrimitiveFieldValue::from(96_u32).into()
-            )],
+            common_context: vec![("ercc", PrimitiveFieldValue::from(96_u32).into())],
             specific_context: vec![],
             payload: vec![
-                (
-                    Intern::new("f32".to_owned()),
-                    PrimitiveFieldValue::from(1.1_f32).into()
-                ),
-                (
-                    Intern::new("f64".to_owned()),
-                    PrimitiveFieldValue::from(2.2_f64).into()
-                ),
+                ("f32", PrimitiveFieldValue::from(1.1_f32).into()),
+                ("f64", PrimitiveFieldValue::from(2.2_f64).into()),
             ],
         })
     );
@@ -196,91 +1107,59 @@ fn check_event_2(e: Option<&Event>) {
 
 fn check_event_3(e: Option<&Event>) {
     assert_eq!(
-        e,
-        Some(&Event {
+        e.map(EventView::from),
+        Some(EventView {
             id: 1,
-            name: Intern::new("enums".to_owned()),
+            name: "enums",
             timestamp: 3,
             log_level: None,
-            common_context: vec![(
-                Intern::new("ercc".to_owned()),
-                PrimitiveFieldValue::from(95_u32).into()
-            )],
+            common_context: vec![("ercc", PrimitiveFieldValue::from(95_u32).into())],
             specific_context: vec![],
             payload: vec![
-                (
-                    Intern::new("foo".to_owned()),
-                    PrimitiveFieldValue::Enumeration(
-                        0,
-                        PreferredDisplayBase::Decimal,
-                        Intern::new("A".to_owned()).into()
-                    )
-                    .into()
-                ),
-                (
-                    Intern::new("bar".to_owned()),
-                    PrimitiveFieldValue::Enumeration(
-                        -1,
-                        PreferredDisplayBase::Decimal,
-                        Intern::new("C".to_owned()).into()
-                    )
-                    .into()
-                ),
-                (
-                    Intern::new("biz".to_owned()),
-                    PrimitiveFieldValue::Enumeration(
-                        19,
-                        PreferredDisplayBase::Decimal,
-                        Intern::new("RUNNING".to_owned()).into()
-                    )
-                    .into()
-                ),
-                (
-                    Intern::new("baz".to_owned()),
-                    PrimitiveFieldValue::Enumeration(
-                        200,
-                        PreferredDisplayBase::Hexadecimal,
-                        Intern::new("on/off".to_owned()).into()
-                    )
-                    .into()
-                ),
+                ("foo", PrimitiveFieldValue::Enumeration(0).into()),
+                ("bar", PrimitiveFieldValue::Enumeration(-1).into()),
+                ("biz", PrimitiveFieldValue::Enumeration(19).into()),
+                ("baz", PrimitiveFieldValue::Enumeration(200).into()),
             ],
         })
     );
+
+    let labels = e
+        .unwrap()
+        .payload()
+        .map(|(s, v)| match v {
+            FieldValue::Primitive(pv) => {
+                (s.display_base(), s.label(pv).map(|l| l.as_str().to_owned()))
+            }
+            FieldValue::Array(_) => panic!("Expected a primitive value"),
+        })
+        .collect::<Vec<_>>();
+    assert_eq!(
+        labels,
+        vec![
+            (PreferredDisplayBase::Decimal, Some("A".to_owned())),
+            (PreferredDisplayBase::Decimal, Some("C".to_owned())),
+            (PreferredDisplayBase::Decimal, Some("RUNNING".to_owned())),
+            (PreferredDisplayBase::Hexadecimal, Some("on/off".to_owned())),
+        ]
+    );
 }
 
 fn check_event_4(e: Option<&Event>) {
     assert_eq!(
-        e,
-        Some(&Event {
+        e.map(EventView::from),
+        Some(EventView {
             id: 0,
-            name: Intern::new("arrays".to_owned()),
+            name: "arrays",
             timestamp: 4,
             log_level: None,
-            common_context: vec![(
-                Intern::new("ercc".to_owned()),
-                PrimitiveFieldValue::from(94_u32).into()
-            )],
+            common_context: vec![("ercc", PrimitiveFieldValue::from(94_u32).into())],
             specific_context: vec![],
             payload: vec![
+                ("foo", ArrayFieldValue::U16(vec![1, 2, 3, 4]).into()),
                 (
-                    Intern::new("foo".to_owned()),
-                    vec![
-                        PrimitiveFieldValue::from(1_u32),
-                        PrimitiveFieldValue::from(2_u32),
-                        PrimitiveFieldValue::from(3_u32),
-                        PrimitiveFieldValue::from(4_u32),
-                    ]
-                    .into()
-                ),
-                (
-                    Intern::new("bar".to_owned()),
-                    vec![
-                        PrimitiveFieldValue::from("b0"),
-                        PrimitiveFieldValue::from("b1"),
-                        PrimitiveFieldValue::from("b2"),
-                    ]
-                    .into()
+                    "bar",
+                    ArrayFieldValue::String(vec!["b0".into(), "b1".into(), "b2".into()]).into()
                 ),
             ],
         })
@@ -289,16 +1168,13 @@ fn check_event_4(e: Option<&Event>) {
 
 fn check_event_5(e: Option<&Event>) {
     assert_eq!(
-        e,
-        Some(&Event {
+        e.map(EventView::from),
+        Some(EventView {
             id: 5,
-            name: Intern::new("shutdown".to_owned()),
+            name: "shutdown",
             timestamp: 5,
             log_level: None,
-            common_context: vec![(
-                Intern::new("ercc".to_owned()),
-                PrimitiveFieldValue::from(93_u32).into()
-            )],
+            common_context: vec![("ercc", PrimitiveFieldValue::from(93_u32).into())],
             specific_context: vec![],
             payload: vec![],
         })
@@ -75,27 +75,29 @@ fn check_simple_packet(pkt: Packet) {
         }
     );
     assert_eq!(
-        pkt.events.first(),
-        Some(&Event {
-            id: 0,
-            name: Intern::new("init".to_owned()),
-            timestamp: 0,
-            log_level: None,
-            common_context: vec![],
-            specific_context: vec![],
-            payload: vec![],
-        })
+        pkt.events.first().map(|e| (
+            e.id(),
+            e.name(),
+            e.timestamp,
+            e.log_level(),
+            e.values.as_slice()
+        )),
+        Some((0, Intern::new("init".to_owned()), 0, None, [].as_slice()))
     );
     assert_eq!(
-        pkt.events.get(1),
-        Some(&Event {
-            id: 1,
-            name: Intern::new("shutdown".to_owned()),
-            timestamp: 1,
-            log_level: None,
-            common_context: vec![],
-            specific_context: vec![],
-            payload: vec![],
-        })
+        pkt.events.get(1).map(|e| (
+            e.id(),
+            e.name(),
+            e.timestamp,
+            e.log_level(),
+            e.values.as_slice()
+        )),
+        Some((
+            1,
+            Intern::new("shutdown".to_owned()),
+            1,
+            None,
+            [].as_slice()
+        ))
     );
 }